@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Chip8.hpp"
+#include "ThreadPool.hpp"
+
+/**
+ * Many independent CHIP-8 machines stepped together on a thread pool.
+ *
+ * Machines share nothing, so a frame step is a parallel loop over them with no locking.
+ * Input and video go straight to each machine's keypad and framebuffer: set keys between
+ * RunFrames() calls, and read Video() while no frames are running.
+ */
+class Batch
+{
+public:
+    /**
+     * @param machineCount The number of machines.
+     * @param threadCount The number of threads stepping them; 0 uses every hardware thread.
+     */
+    explicit Batch(size_t machineCount, unsigned int threadCount = 0);
+
+    /**
+     * Loads the same ROM file into every machine, reading it once.
+     * @param filename The path to the ROM file.
+     * @return true if the ROM was read and fits in program memory.
+     */
+    bool LoadROM(const std::string& filename);
+
+    /**
+     * Loads a ROM image into every machine.
+     * @param data The ROM bytes.
+     * @param size The number of bytes.
+     * @return true if the ROM fits in program memory.
+     */
+    bool LoadROM(uint8_t const* data, size_t size);
+
+    /**
+     * Runs a number of 60 Hz frames on every machine, in parallel, returning when all are done.
+     * @param frames The number of frames to run.
+     * @param instructionsPerFrame The number of instructions per frame.
+     */
+    void RunFrames(unsigned int frames, unsigned int instructionsPerFrame);
+
+    /**
+     * Selects the interpreter backend of every machine.
+     * @param backend The backend to use from now on.
+     */
+    void SetBackend(Backend backend);
+
+    /**
+     * Selects the quirk profile of every machine.
+     * @param profile The profile to use from now on.
+     */
+    void SetQuirks(QuirkProfile profile);
+
+    /**
+     * Seeds every machine's random number generator, machine i with seed + i, so runs repeat exactly.
+     * @param seed The seed of the first machine.
+     */
+    void Seed(uint32_t seed);
+
+    /**
+     * Presses or releases a key on one machine.
+     * @param machine The machine index.
+     * @param key The key, 0 to F.
+     * @param pressed Whether the key is held down.
+     */
+    void SetKey(size_t machine, unsigned int key, bool pressed) { machines[machine].keypad[key & (KEY_COUNT - 1)] = pressed; }
+
+    /**
+     * @return One machine's framebuffer, updated in place by RunFrames().
+     */
+    VideoBuffer const& Video(size_t machine) const { return machines[machine].video; }
+
+    Chip8& Machine(size_t machine) { return machines[machine]; }
+
+    size_t Size() const { return machines.size(); }
+
+    unsigned int ThreadCount() const { return pool.ThreadCount(); }
+
+    /**
+     * @return The instructions every machine has executed, summed (see Chip8::InstructionCount()).
+     */
+    uint64_t InstructionCount() const;
+
+    /**
+     * @return The cycles every machine's idle-loop skipping ran off, summed.
+     */
+    uint64_t SkippedCycleCount() const;
+
+private:
+    std::vector<Chip8> machines;
+    ThreadPool pool;
+};
@@ -1,119 +1,749 @@
 #pragma once
 
 #include <array>
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
-#include <random>
+#include <memory>
+#include <string>
 
 // Constants defining the CHIP-8 specifications
-constexpr unsigned int KEY_COUNT        = 16;    // Number of keys in the CHIP-8 keypad
-constexpr unsigned int MEMORY_SIZE      = 4096;  // Size of the CHIP-8 memory
-constexpr unsigned int REGISTER_COUNT   = 16;    // Number of registers in the CHIP-8
-constexpr unsigned int STACK_LEVELS     = 16;    // Number of stack levels in the CHIP-8
-constexpr unsigned int VIDEO_HEIGHT     = 32;    // Height of the CHIP-8 display
-constexpr unsigned int VIDEO_WIDTH      = 64;    // Width of the CHIP-8 display
+constexpr unsigned int KEY_COUNT             = 16;     // Number of keys in the CHIP-8 keypad
+constexpr unsigned int MEMORY_SIZE           = 4096;   // Size of the memory of CHIP-8 and SUPER-CHIP machines
+constexpr unsigned int XO_MEMORY_SIZE        = 65536;  // Size of the XO-CHIP memory, allocated only for machines that use it
+constexpr unsigned int CODE_SPACE            = 0x1000; // Addresses 12-bit jumps and calls reach
+constexpr unsigned int REGISTER_COUNT        = 16;     // Number of registers in the CHIP-8
+constexpr unsigned int STACK_LEVELS          = 16;     // Number of stack levels in the CHIP-8
+constexpr unsigned int START_ADDRESS         = 0x200;  // Address programs are loaded at
+constexpr unsigned int VIDEO_HEIGHT          = 32;     // Height of the CHIP-8 display
+constexpr unsigned int VIDEO_WIDTH           = 64;     // Width of the CHIP-8 display
+constexpr unsigned int HIRES_HEIGHT          = 64;     // Height of the SUPER-CHIP high-resolution display
+constexpr unsigned int HIRES_WIDTH           = 128;    // Width of the SUPER-CHIP high-resolution display
+constexpr unsigned int VIDEO_PLANES          = 2;      // XO-CHIP bitplanes; the other variants draw into the first
+constexpr unsigned int VIDEO_PLANE_WORDS     = 128;    // 64-bit words per plane, two per high-resolution row
+constexpr unsigned int FLAG_REGISTER_COUNT   = 16;     // SUPER-CHIP/XO-CHIP persistent flag registers (Fx75/Fx85)
+constexpr unsigned int AUDIO_PATTERN_SIZE    = 16;     // Bytes in the XO-CHIP audio pattern buffer
+constexpr unsigned int FONTSET_SIZE          = 80;     // Bytes of built-in hex digit sprites
+constexpr unsigned int FONTSET_START_ADDRESS = 0x50;   // Address the digit sprites are loaded at
+constexpr unsigned int BIGFONT_SIZE          = 160;    // Bytes of built-in 8x10 hex digit sprites (Fx30)
+constexpr unsigned int BIGFONT_START_ADDRESS = 0xA0;   // Address the large digit sprites are loaded at
+constexpr unsigned int SAVE_STATE_VERSION    = 3;      // Save-state format written by Chip8::SaveState
+constexpr unsigned int SAVE_STATE_SIZE       = 6250;   // Bytes in a save state of a machine with MEMORY_SIZE bytes of memory
+
+// Built-in sprites for the hex digits 0-F, five bytes each
+extern const std::array<uint8_t, FONTSET_SIZE> fontset;
+
+// Built-in SUPER-CHIP/XO-CHIP sprites for the hex digits 0-F, ten bytes each
+extern const std::array<uint8_t, BIGFONT_SIZE> bigFontset;
+
+// Display, bit-packed with the leftmost pixel of a word in its most significant bit. In low resolution
+// (64x32) row y is word y; in high resolution (128x64) it is words 2y and 2y + 1. XO-CHIP draws into two
+// planes whose bits pick one of four colors; the other variants only use the first.
+struct VideoBuffer
+{
+    using Plane = std::array<uint64_t, VIDEO_PLANE_WORDS>;
+
+    std::array<Plane, VIDEO_PLANES> planes{};
+    bool hires = false;
+
+    unsigned int Width() const { return hires ? HIRES_WIDTH : VIDEO_WIDTH; }
+    unsigned int Height() const { return hires ? HIRES_HEIGHT : VIDEO_HEIGHT; }
+
+    // 64-bit words per row
+    unsigned int RowWords() const { return hires ? 2 : 1; }
+
+    // Whether row y looks the same in another buffer of the same resolution
+    bool SameRow(VideoBuffer const& other, unsigned int y) const
+    {
+        const unsigned int words = RowWords();
+        for (unsigned int p = 0; p < VIDEO_PLANES; ++p)
+        {
+            for (unsigned int w = y * words; w < (y + 1) * words; ++w)
+            {
+                if (planes[p][w] != other.planes[p][w]) return false;
+            }
+        }
+        return true;
+    }
+};
+
+// Hashes a framebuffer (64-bit FNV-1a), the way golden-frame manifests record it
+uint64_t HashVideo(VideoBuffer const& video);
+
+// Bytes in a save state of an XO-CHIP machine, the largest there is
+constexpr unsigned int XO_SAVE_STATE_SIZE = SAVE_STATE_SIZE - MEMORY_SIZE + XO_MEMORY_SIZE;
+
+// Buffer that holds a save state of any profile
+using SaveStateBuffer = std::array<uint8_t, XO_SAVE_STATE_SIZE>;
+
+// Small, fast random number generator (xorshift32). Its whole state is one nonzero word,
+// so it is cheap to seed, copy and save.
+class Xorshift32
+{
+public:
+    explicit Xorshift32(uint32_t seed = 0) { Seed(seed); }
+
+    // Starts the sequence for a seed; any value is a valid seed
+    void Seed(uint32_t seed)
+    {
+        state = (seed + 1u) * 0x9E3779B9u;
+        if (state == 0) state = 0x9E3779B9u;
+    }
+
+    uint8_t NextByte()
+    {
+        state ^= state << 13u;
+        state ^= state >> 17u;
+        state ^= state << 5u;
+        return static_cast<uint8_t>(state >> 24u);
+    }
+
+    uint32_t State() const { return state; }
+
+    // Restores a value returned by State(), which is never 0
+    void SetState(uint32_t newState) { state = newState; }
+
+private:
+    uint32_t state;
+};
+
+// Identifies an instruction's handler; also the dispatch key for the switch and threaded backends
+enum class Op : uint8_t
+{
+    OP_NULL,
+    OP_00E0,
+    OP_00EE,
+    OP_1nnn,
+    OP_2nnn,
+    OP_3xkk,
+    OP_4xkk,
+    OP_5xy0,
+    OP_6xkk,
+    OP_7xkk,
+    OP_8xy0,
+    OP_8xy1,
+    OP_8xy2,
+    OP_8xy3,
+    OP_8xy4,
+    OP_8xy5,
+    OP_8xy6,
+    OP_8xy7,
+    OP_8xyE,
+    OP_9xy0,
+    OP_Annn,
+    OP_Bnnn,
+    OP_Cxkk,
+    OP_Dxyn,
+    OP_Ex9E,
+    OP_ExA1,
+    OP_Fx07,
+    OP_Fx0A,
+    OP_Fx15,
+    OP_Fx18,
+    OP_Fx1E,
+    OP_Fx29,
+    OP_Fx33,
+    OP_Fx55,
+    OP_Fx65,
+    OP_00Cn,
+    OP_00Dn,
+    OP_00FB,
+    OP_00FC,
+    OP_00FD,
+    OP_00FE,
+    OP_00FF,
+    OP_5xy2,
+    OP_5xy3,
+    OP_F000,
+    OP_Fn01,
+    OP_F002,
+    OP_Fx30,
+    OP_Fx3A,
+    OP_Fx75,
+    OP_Fx85,
+};
+
+constexpr size_t OP_COUNT = static_cast<size_t>(Op::OP_Fx85) + 1;
+
+// Handler names ("OP_00E0" ...), indexed by Op
+extern const std::array<char const*, OP_COUNT> opNames;
+
+// Decodes an opcode into the Op the interpreter executes it as; unknown opcodes are OP_NULL
+Op Decode(uint16_t opcode);
+
+// Disassembles an opcode into the instruction it executes as, e.g. "LD VA, 0x3C"
+std::string Disassemble(uint16_t opcode);
+
+// Interpreter backends. All of them execute the same Chip8 state.
+enum class Backend : uint8_t
+{
+    Table,      // Pointer-to-member call through the handler table
+    Switch,     // Dense switch over Op
+    Threaded,   // Computed-goto dispatch (GCC/Clang), otherwise the same as Switch
+    Jit,        // x86-64 dynamic recompiler, otherwise the same as Threaded
+    Static      // Ahead-of-time recompiled ROM, attached with SetStaticProgram()
+};
+
+// CHIP-8 variants, which disagree on a few instructions (see Quirks). The interpreters are compiled
+// once per profile, so supporting a variant costs nothing per instruction.
+enum class QuirkProfile : uint8_t
+{
+    Modern,     // What most ROMs written today expect; this core's behavior before profiles existed
+    CosmacVip,  // The original COSMAC VIP interpreter
+    SuperChip,  // SUPER-CHIP 1.1 on the HP 48
+    XoChip      // XO-CHIP, as implemented by Octo
+};
+
+// Behaviors the variants disagree on
+struct Quirks
+{
+    bool shiftVy;           // 8xy6/8xyE shift Vy into Vx, instead of shifting Vx in place
+    bool incrementIndex;    // Fx55/Fx65 leave I past the last register transferred
+    bool jumpVx;            // Bnnn jumps to xnn + Vx (Bxnn), instead of to nnn + V0
+    bool resetVF;           // 8xy1/8xy2/8xy3 clear VF
+    bool wrapSprites;       // Dxyn wraps sprites around the display edges, instead of clipping them
+    bool superChip;         // SUPER-CHIP instructions: high resolution, scrolling, 16x16 sprites, big font, flags, exit
+    bool xoChip;            // XO-CHIP instructions: 64 KB memory, bitplanes, audio pattern, 5xy2/5xy3, F000 NNNN
+};
+
+// The quirks of a profile
+constexpr Quirks QuirksOf(QuirkProfile profile)
+{
+    switch (profile)
+    {
+        //                                   shiftVy incrementIndex jumpVx resetVF wrapSprites superChip xoChip
+        case QuirkProfile::CosmacVip: return {true,   true,          false, true,   false,      false,    false};
+        case QuirkProfile::SuperChip: return {false,  false,         true,  false,  false,      true,     false};
+        case QuirkProfile::XoChip:    return {true,   true,          false, false,  true,       true,     true};
+        default:                      return {false,  false,         false, false,  false,      false,    false};
+    }
+}
+
+// Bytes of memory a machine of a profile has; addresses wrap at the end
+constexpr unsigned int MemorySizeOf(QuirkProfile profile)
+{
+    return QuirksOf(profile).xoChip ? XO_MEMORY_SIZE : MEMORY_SIZE;
+}
+
+// Bytes of ROM a profile loads: up to the end of its memory
+constexpr unsigned int RomCapacity(QuirkProfile profile)
+{
+    return MemorySizeOf(profile) - START_ADDRESS;
+}
+
+// Bytes in a save state of a machine of a profile
+constexpr unsigned int SaveStateSizeOf(QuirkProfile profile)
+{
+    return SAVE_STATE_SIZE - MEMORY_SIZE + MemorySizeOf(profile);
+}
+
+// Profile names as given on command lines and in manifests: "modern", "vip", "schip", "xochip"
+char const* QuirkProfileName(QuirkProfile profile);
+
+// Parses a profile name; returns false, leaving profile unchanged, if the name is unknown
+bool ParseQuirkProfile(std::string const& name, QuirkProfile& profile);
+
+// Backend used by newly constructed machines; the build can override it
+#ifndef CHIP8_DEFAULT_BACKEND
+#define CHIP8_DEFAULT_BACKEND Threaded
+#endif
+
+class Chip8;
+class Debugger;
+class TraceRing;
+class Translator;
+struct StaticProgram;
+
+// A decoded instruction: which handler executes it and its operands, extracted once
+struct Instruction
+{
+    uint16_t opcode{};
+    uint16_t nnn{};     // Lowest 12 bits (address)
+    Op op{};
+    uint8_t x{};        // Lower nibble of the high byte (register)
+    uint8_t y{};        // Upper nibble of the low byte (register)
+    uint8_t kk{};       // Lowest 8 bits (byte)
+    uint8_t n{};        // Lowest 4 bits (nibble)
+    bool decoded{};     // false until the entry has been filled in
+};
+
+// Execution counts gathered by a profiled machine. Only the machine's thread writes them; any
+// thread may read them while it runs.
+struct ProfileCounters
+{
+    explicit ProfileCounters(unsigned int memorySize)
+        : pcHits(std::make_unique<std::atomic<uint64_t>[]>(memorySize)), addresses(memorySize) {}
+
+    std::array<std::atomic<uint64_t>, OP_COUNT> ops{};          // Instructions executed, per handler
+    std::unique_ptr<std::atomic<uint64_t>[]> pcHits;            // Instructions executed, per address
+    unsigned int addresses;                                     // Entries in pcHits: the memory size of the profile
+    std::atomic<uint64_t> frames{};                             // Frames run
+};
+
+// Profiling policy of builds without CHIP8_PROFILE: every hook compiles to nothing
+struct NullProfiler
+{
+    static constexpr bool ENABLED = false;
+
+    void Count(Op, uint16_t) {}
+    void Frame() {}
+    void SetMemorySize(unsigned int) {}
+    ProfileCounters const* Counters() const { return nullptr; }
+};
+
+// Profiling policy of builds with CHIP8_PROFILE: counts every interpreted instruction and frame
+class CountingProfiler
+{
+public:
+    static constexpr bool ENABLED = true;
+
+    void Count(Op op, uint16_t address)
+    {
+        Bump(counters->ops[static_cast<size_t>(op)]);
+        Bump(counters->pcHits[address & (counters->addresses - 1)]);
+    }
+
+    void Frame() { Bump(counters->frames); }
+
+    // Starts the counts over for a machine with a different amount of memory; not while others read them
+    void SetMemorySize(unsigned int size)
+    {
+        if (counters->addresses != size) counters = std::make_unique<ProfileCounters>(size);
+    }
+
+    ProfileCounters const* Counters() const { return counters.get(); }
+
+private:
+    // There is one writer, so a plain load and store does instead of a locked increment
+    static void Bump(std::atomic<uint64_t>& counter)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    std::unique_ptr<ProfileCounters> counters = std::make_unique<ProfileCounters>(MEMORY_SIZE);
+};
+
+#if CHIP8_PROFILE
+using Profiler = CountingProfiler;
+#else
+using Profiler = NullProfiler;
+#endif
 
 class Chip8
 {
 public:
     Chip8();
+    ~Chip8();
+
+    Chip8(Chip8&&) noexcept;
+    Chip8& operator=(Chip8&&) noexcept;
     
     /**
      * Loads a ROM file into the CHIP-8 memory.
      * @param filename The path to the ROM file.
+     * @return true if the ROM was read and fits in program memory (RomCapacity() of the profile).
+     */
+    bool LoadROM(const std::string& filename);
+
+    /**
+     * Loads a ROM image from memory into the CHIP-8 memory.
+     * @param data The ROM bytes.
+     * @param size The number of bytes.
+     * @return true if the ROM fits in program memory.
      */
-    void LoadROM(const std::string& filename);
+    bool LoadROM(uint8_t const* data, size_t size);
     
     /**
      * Executes one cycle of the CHIP-8 CPU.
      */
     void Cycle();
 
+    /**
+     * Decrements the delay and sound timers. Called once per 60 Hz frame.
+     */
+    void TickTimers();
+
+    /**
+     * Executes one 60 Hz frame: a fixed number of CPU cycles followed by one timer tick.
+     * @param instructionsPerFrame The number of instructions to execute in the frame.
+     */
+    void RunFrame(unsigned int instructionsPerFrame);
+
+    /**
+     * Executes a number of CPU cycles with the selected backend, without ticking the timers.
+     * @param cycles The number of instructions to execute.
+     */
+    void Run(unsigned int cycles);
+
+    /**
+     * Selects the interpreter backend used by Run() and RunFrame().
+     * @param newBackend The backend to use from now on.
+     */
+    void SetBackend(Backend newBackend);
+
+    Backend GetBackend() const { return backend; }
+
+    /**
+     * Selects the CHIP-8 variant the machine behaves as; pick it when loading the ROM. Every backend
+     * runs code specialized for the profile, so switching is cheap to run but drops translated code.
+     * @param profile The profile to use from now on.
+     */
+    void SetQuirks(QuirkProfile profile);
+
+    QuirkProfile GetQuirks() const { return quirkProfile; }
+
+    /**
+     * Runs a ROM recompiled ahead of time by chip8-recompile, selecting the Static backend.
+     * Load the same ROM first; blocks whose bytes are not in memory are interpreted instead.
+     * @param program The recompiled program, which must outlive this machine.
+     */
+    void SetStaticProgram(StaticProgram const& program);
+
+    /**
+     * Records every instruction executed from now on into a trace ring; null stops tracing.
+     * While tracing, Run() uses a dedicated interpreter loop whatever the backend, so an
+     * untraced machine pays nothing for it.
+     * @param ring The ring, which must outlive its use here.
+     */
+    void SetTrace(TraceRing* ring) { trace = ring; }
+
+    /**
+     * Lets a debugger stop this machine while it is attached; null removes it. An attached
+     * debugger makes Run() interpret every instruction in a loop that checks its breakpoints
+     * and watchpoints; a detached one costs a single check per Run().
+     * @param newDebugger The debugger, which must outlive its use here.
+     */
+    void SetDebugger(Debugger* newDebugger) { debugger = newDebugger; }
+
+    /**
+     * Reseeds the random number generator behind Cxkk. Machines seeded alike, given the same ROM
+     * and keys, run identically; otherwise the seed comes from std::random_device.
+     * @param seed The seed.
+     */
+    void Seed(uint32_t seed) { random.Seed(seed); }
+
+    /**
+     * @return The execution counts of a build with CHIP8_PROFILE, or null without it. Counts cover
+     * interpreted instructions; profiled builds interpret Jit and Static too, and skipped idle
+     * loops are not counted.
+     */
+    ProfileCounters const* Profile() const { return profiler.Counters(); }
+
+    /**
+     * @return Whether the machine is halted in Fx0A until a key is pressed. Run() and RunFrame()
+     * return at once while it is and no key is down, only the timers keep ticking.
+     */
+    bool WaitingForKey() const { return waitingForKey; }
+
+    /**
+     * @return The instructions Run() has executed since construction. Cycles run off by idle-loop
+     * skipping and cycles left over while halted in Fx0A are not counted.
+     */
+    uint64_t InstructionCount() const { return instructionCount; }
+
+    /**
+     * @return The cycles idle-loop skipping has run off without executing them, since construction.
+     */
+    uint64_t SkippedCycleCount() const { return skippedCycleCount; }
+
+    /**
+     * @return The bytes SaveState() writes, SaveStateSizeOf() the current profile.
+     */
+    size_t SaveStateSize() const { return SaveStateSizeOf(quirkProfile); }
+
+    /**
+     * Writes the machine state (CPU, stack, timers, video, memory and random generator) into a buffer,
+     * without allocating. The keypad is input and is not saved.
+     * @param data The buffer, at least SaveStateSize() bytes.
+     * @param size The size of the buffer.
+     * @return true if the buffer was large enough.
+     */
+    bool SaveState(uint8_t* data, size_t size) const;
+
+    /**
+     * Restores a state written by SaveState(), without allocating. Only the decoded and translated
+     * code for memory that actually changed is dropped, so restoring a nearby state is cheap. The
+     * state must come from a machine with as much memory as this one's profile.
+     * @param data The save state.
+     * @param size The number of bytes available.
+     * @return true if the state was valid and restored; false leaves the machine unchanged.
+     */
+    bool LoadState(uint8_t const* data, size_t size);
+
+    /**
+     * @return The XO-CHIP audio pattern (F002): 128 one-bit samples the buzzer loops while the sound
+     * timer runs. Other variants leave it at its power-on square wave.
+     */
+    std::array<uint8_t, AUDIO_PATTERN_SIZE> const& AudioPattern() const { return audioPattern; }
+
+    /**
+     * @return The XO-CHIP pattern playback pitch (Fx3A); the pattern plays at 4000 * 2^((pitch - 64) / 48) bits per second.
+     */
+    uint8_t Pitch() const { return pitch; }
+
+    /**
+     * @return A counter that changes whenever an instruction or LoadState() changes video,
+     * so a frontend can skip presenting frames that look the same as the last one.
+     */
+    uint32_t VideoGeneration() const { return videoGeneration; }
+
     // CHIP-8 keypad state
     std::array<uint8_t, KEY_COUNT> keypad{};
     
-    // CHIP-8 video memory (display)
-    std::array<uint32_t, VIDEO_WIDTH * VIDEO_HEIGHT> video{};
+    // CHIP-8 video memory (display), bit-packed one or two words per row
+    VideoBuffer video{};
 
 private:
-    // Function tables for opcode handling
-    void Table0();
-    void Table8();
-    void TableE();
-    void TableF();
+    // The recompilers read machine state directly and call back into the handlers
+    friend class Jit;
+    friend class StaticRunner;
+    friend struct StaticRuntime;
+
+    // The debugger inspects a stopped machine
+    friend class Debugger;
+
+    // Backend loops behind Run(), specialized per quirk profile. Each returns the cycles it did not
+    // execute: those an idle-loop skip ran off, or the rest of the budget once Fx0A halts.
+    template <QuirkProfile P> unsigned int RunBackend(unsigned int cycles);
+    template <QuirkProfile P> unsigned int RunTable(unsigned int cycles);
+    template <QuirkProfile P> unsigned int RunSwitch(unsigned int cycles);
+    template <QuirkProfile P> unsigned int RunThreaded(unsigned int cycles);
+    unsigned int RunTraced(unsigned int cycles);
+    unsigned int RunDebugged(unsigned int cycles);
+
+    // Returns the decoded instruction at an address, decoding it on first use
+    Instruction const& Fetch(uint16_t address);
+
+    // Decodes the instruction at an address into its Op and operands
+    Instruction Decode(uint16_t address) const;
+
+    // Calls the handler for a decoded instruction, as the quirk profile specializes it
+    void Execute(Instruction const& in) { (this->*(*handlerTable)[static_cast<size_t>(in.op)])(in); }
+
+    // Runs off a whole budget of cycles at once if pc sits in an idle loop that cannot end before
+    // the timers tick or the keypad changes; returns false, changing nothing, otherwise
+    bool SkipIdleLoop(unsigned int cycles);
+
+    // Whether a jump, fetched with pc already past it, goes back to itself or to two instructions
+    // before it; only those can close a loop SkipIdleLoop() recognizes
+    bool ShortBackJump(Instruction const& in) const
+    {
+        unsigned int back = static_cast<uint16_t>(pc - in.nnn);
+        return back == 2 || back == 6;
+    }
+
+    // Drops decoded instructions overlapping memory that was just written
+    void InvalidateCode(unsigned int address, unsigned int length);
+
+    // Memory of the current profile, MemorySizeOf() bytes of it: the XO-CHIP memory, or the built-in one
+    uint8_t* Memory() { return extendedMemory ? extendedMemory->data() : memory.data(); }
+    uint8_t const* Memory() const { return extendedMemory ? extendedMemory->data() : memory.data(); }
+
+    // Memory of a profile, for handlers specialized for it
+    template <QuirkProfile P>
+    uint8_t* MemoryOf()
+    {
+        if constexpr (QuirksOf(P).xoChip) return extendedMemory->data();
+        else return memory.data();
+    }
+
+    // Skips the next instruction; on XO-CHIP that is all four bytes of an F000 NNNN
+    template <QuirkProfile P>
+    void SkipNext()
+    {
+        if constexpr (QuirksOf(P).xoChip)
+        {
+            uint8_t const* mem = MemoryOf<P>();
+            pc += (mem[pc] == 0xF0 && mem[static_cast<uint16_t>(pc + 1)] == 0x00) ? 4 : 2;
+        }
+        else pc += 2;
+    }
+
+    // Switches the display resolution, clearing every plane as SUPER-CHIP does
+    void SetHires(bool hires);
+
+    // Scrolls the selected planes by whole rows, down for positive counts
+    void ScrollRows(int rows);
+
+    // Scrolls the selected planes sideways by fewer than 64 pixels, right for positive counts
+    void ScrollPixels(int pixels);
+
+    // Dxyn as SUPER-CHIP and XO-CHIP run it: either resolution, 16x16 sprites, every selected plane
+    template <QuirkProfile P>
+    void DrawSprite(Instruction const& in);
+
+    // Records that video changed, for VideoGeneration()
+    void MarkVideoChanged() { ++videoGeneration; }
 
     // Opcode implementations
-    void OP_NULL();    // Do nothing
-    void OP_00E0();    // Clear the display
-    void OP_00EE();    // Return from a subroutine
-    void OP_1nnn();    // Jump to address nnn
-    void OP_2nnn();    // Call subroutine at nnn
-    void OP_3xkk();    // Skip next instruction if Vx == kk
-    void OP_4xkk();    // Skip next instruction if Vx != kk
-    void OP_5xy0();    // Skip next instruction if Vx == Vy
-    void OP_6xkk();    // Set Vx = kk
-    void OP_7xkk();    // Set Vx = Vx + kk
-    void OP_8xy0();    // Set Vx = Vy
-    void OP_8xy1();    // Set Vx = Vx OR Vy
-    void OP_8xy2();    // Set Vx = Vx AND Vy
-    void OP_8xy3();    // Set Vx = Vx XOR Vy
-    void OP_8xy4();    // Set Vx = Vx + Vy, set VF = carry
-    void OP_8xy5();    // Set Vx = Vx - Vy, set VF = NOT borrow
-    void OP_8xy6();    // Set Vx = Vx SHR 1
-    void OP_8xy7();    // Set Vx = Vy - Vx, set VF = NOT borrow
-    void OP_8xyE();    // Set Vx = Vx SHL 1
-    void OP_9xy0();    // Skip next instruction if Vx != Vy
-    void OP_Annn();    // Set I = nnn
-    void OP_Bnnn();    // Jump to location nnn + V0
-    void OP_Cxkk();    // Set Vx = random byte AND kk
-    void OP_Dxyn();    // Display n-byte sprite starting at memory location I at (Vx, Vy), set VF = collision
-    void OP_Ex9E();    // Skip next instruction if key with the value of Vx is pressed
-    void OP_ExA1();    // Skip next instruction if key with the value of Vx is not pressed
-    void OP_Fx07();    // Set Vx = delay timer value
-    void OP_Fx0A();    // Wait for a key press, store the value of the key in Vx
-    void OP_Fx15();    // Set delay timer = Vx
-    void OP_Fx18();    // Set sound timer = Vx
-    void OP_Fx1E();    // Set I = I + Vx
-    void OP_Fx29();    // Set I = location of sprite for digit Vx
-    void OP_Fx33();    // Store BCD representation of Vx in memory locations I, I+1, and I+2
-    void OP_Fx55();    // Store registers V0 through Vx in memory starting at location I
-    void OP_Fx65();    // Read registers V0 through Vx from memory starting at location I
-
-    // CHIP-8 memory
-    std::array<uint8_t, MEMORY_SIZE> memory{};
-    
+    void OP_NULL(Instruction const& in);    // Do nothing
+    void OP_00E0(Instruction const& in);    // Clear the display
+    void OP_00EE(Instruction const& in);    // Return from a subroutine
+    void OP_1nnn(Instruction const& in);    // Jump to address nnn
+    void OP_2nnn(Instruction const& in);    // Call subroutine at nnn
+    template <QuirkProfile P>
+    void OP_3xkk(Instruction const& in);    // Skip next instruction if Vx == kk
+    template <QuirkProfile P>
+    void OP_4xkk(Instruction const& in);    // Skip next instruction if Vx != kk
+    template <QuirkProfile P>
+    void OP_5xy0(Instruction const& in);    // Skip next instruction if Vx == Vy
+    void OP_6xkk(Instruction const& in);    // Set Vx = kk
+    void OP_7xkk(Instruction const& in);    // Set Vx = Vx + kk
+    void OP_8xy0(Instruction const& in);    // Set Vx = Vy
+    template <QuirkProfile P>
+    void OP_8xy1(Instruction const& in);    // Set Vx = Vx OR Vy (quirk: clear VF)
+    template <QuirkProfile P>
+    void OP_8xy2(Instruction const& in);    // Set Vx = Vx AND Vy (quirk: clear VF)
+    template <QuirkProfile P>
+    void OP_8xy3(Instruction const& in);    // Set Vx = Vx XOR Vy (quirk: clear VF)
+    void OP_8xy4(Instruction const& in);    // Set Vx = Vx + Vy, set VF = carry
+    void OP_8xy5(Instruction const& in);    // Set Vx = Vx - Vy, set VF = NOT borrow
+    template <QuirkProfile P>
+    void OP_8xy6(Instruction const& in);    // Set Vx = Vx SHR 1 (quirk: Vy SHR 1)
+    void OP_8xy7(Instruction const& in);    // Set Vx = Vy - Vx, set VF = NOT borrow
+    template <QuirkProfile P>
+    void OP_8xyE(Instruction const& in);    // Set Vx = Vx SHL 1 (quirk: Vy SHL 1)
+    template <QuirkProfile P>
+    void OP_9xy0(Instruction const& in);    // Skip next instruction if Vx != Vy
+    void OP_Annn(Instruction const& in);    // Set I = nnn
+    template <QuirkProfile P>
+    void OP_Bnnn(Instruction const& in);    // Jump to location nnn + V0 (quirk: xnn + Vx)
+    void OP_Cxkk(Instruction const& in);    // Set Vx = random byte AND kk
+    template <QuirkProfile P>
+    void OP_Dxyn(Instruction const& in);    // Display n-byte sprite starting at memory location I at (Vx, Vy), set VF = collision (quirk: wrap at the edges)
+    template <QuirkProfile P>
+    void OP_Ex9E(Instruction const& in);    // Skip next instruction if key with the value of Vx is pressed
+    template <QuirkProfile P>
+    void OP_ExA1(Instruction const& in);    // Skip next instruction if key with the value of Vx is not pressed
+    void OP_Fx07(Instruction const& in);    // Set Vx = delay timer value
+    void OP_Fx0A(Instruction const& in);    // Wait for a key press, store the value of the key in Vx
+    void OP_Fx15(Instruction const& in);    // Set delay timer = Vx
+    void OP_Fx18(Instruction const& in);    // Set sound timer = Vx
+    void OP_Fx1E(Instruction const& in);    // Set I = I + Vx
+    void OP_Fx29(Instruction const& in);    // Set I = location of sprite for digit Vx
+    template <QuirkProfile P>
+    void OP_Fx33(Instruction const& in);    // Store BCD representation of Vx in memory locations I, I+1, and I+2
+    template <QuirkProfile P>
+    void OP_Fx55(Instruction const& in);    // Store registers V0 through Vx in memory starting at location I (quirk: advance I)
+    template <QuirkProfile P>
+    void OP_Fx65(Instruction const& in);    // Read registers V0 through Vx from memory starting at location I (quirk: advance I)
+
+    // SUPER-CHIP and XO-CHIP opcodes; no-ops, or the instruction they decode as above, on the other variants
+    template <QuirkProfile P>
+    void OP_00Cn(Instruction const& in);    // Scroll the display down n rows
+    template <QuirkProfile P>
+    void OP_00Dn(Instruction const& in);    // Scroll the display up n rows (XO-CHIP)
+    template <QuirkProfile P>
+    void OP_00FB(Instruction const& in);    // Scroll the display right 4 pixels
+    template <QuirkProfile P>
+    void OP_00FC(Instruction const& in);    // Scroll the display left 4 pixels
+    template <QuirkProfile P>
+    void OP_00FD(Instruction const& in);    // Exit the interpreter
+    template <QuirkProfile P>
+    void OP_00FE(Instruction const& in);    // Switch to low resolution
+    template <QuirkProfile P>
+    void OP_00FF(Instruction const& in);    // Switch to high resolution
+    template <QuirkProfile P>
+    void OP_5xy2(Instruction const& in);    // Store registers Vx through Vy in memory starting at location I (XO-CHIP)
+    template <QuirkProfile P>
+    void OP_5xy3(Instruction const& in);    // Read registers Vx through Vy from memory starting at location I (XO-CHIP)
+    template <QuirkProfile P>
+    void OP_F000(Instruction const& in);    // Set I = the 16-bit word following the instruction, and skip it (XO-CHIP)
+    template <QuirkProfile P>
+    void OP_Fn01(Instruction const& in);    // Select the planes n drawing and scrolling affect (XO-CHIP)
+    template <QuirkProfile P>
+    void OP_F002(Instruction const& in);    // Load the audio pattern from memory starting at location I (XO-CHIP)
+    template <QuirkProfile P>
+    void OP_Fx30(Instruction const& in);    // Set I = location of the large sprite for digit Vx
+    template <QuirkProfile P>
+    void OP_Fx3A(Instruction const& in);    // Set the audio pattern pitch = Vx (XO-CHIP)
+    template <QuirkProfile P>
+    void OP_Fx75(Instruction const& in);    // Store registers V0 through Vx in the flag registers
+    template <QuirkProfile P>
+    void OP_Fx85(Instruction const& in);    // Read registers V0 through Vx from the flag registers
+
+    // The state nearly every instruction touches, packed into one cache line
+
     // CHIP-8 registers
-    std::array<uint8_t, REGISTER_COUNT> registers{};
-    
+    alignas(64) std::array<uint8_t, REGISTER_COUNT> registers{};
+
+    // Program counter
+    uint16_t pc{};
+
+    // Index register
+    uint16_t index{};
+
+    // Stack pointer; it wraps, and only its low bits index the stack
+    uint8_t sp{};
+
     // Delay timer
     uint8_t delayTimer{};
-    
+
     // Sound timer
     uint8_t soundTimer{};
-    
-    // Stack pointer
-    uint8_t sp{};
 
     // CHIP-8 stack
     std::array<uint16_t, STACK_LEVELS> stack{};
-    
-    // Index register
-    uint16_t index{};
-    
-    // Program counter
-    uint16_t pc{};
-    
-    // Current opcode
-    uint16_t opcode{};
+
+    // XO-CHIP planes drawing, scrolling and clearing affect, one bit per plane
+    uint8_t planeMask = 1;
+
+    // XO-CHIP audio pattern playback pitch
+    uint8_t pitch = 64;
+
+    // Halted in Fx0A; pc still points at it, so it runs again once a key is down
+    bool waitingForKey = false;
+
+    // Bumped on every change to video
+    uint32_t videoGeneration{};
+
+    // CHIP-8 memory; an XO-CHIP machine uses extendedMemory instead
+    std::array<uint8_t, MEMORY_SIZE> memory{};
+
+    // SUPER-CHIP/XO-CHIP flag registers, which outlive the program on real hardware
+    std::array<uint8_t, FLAG_REGISTER_COUNT> flagRegisters{};
+
+    // XO-CHIP audio pattern, a square wave until a program loads its own
+    std::array<uint8_t, AUDIO_PATTERN_SIZE> audioPattern{
+        0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF};
 
     // Random number generator
-    std::default_random_engine randGen;
-    std::uniform_int_distribution<uint8_t> randByte;
-
-    // Function pointers for opcode handling
-    using Chip8Func = void (Chip8::*)();
-    std::array<Chip8Func, 0xF  + 1> table ;
-    std::array<Chip8Func, 0xE  + 1> table0;
-    std::array<Chip8Func, 0xE  + 1> table8;
-    std::array<Chip8Func, 0xE  + 1> tableE;
-    std::array<Chip8Func, 0x65 + 1> tableF;
+    Xorshift32 random;
+
+    // Instructions executed and cycles skipped in idle loops, for InstructionCount() and SkippedCycleCount()
+    uint64_t instructionCount = 0;
+    uint64_t skippedCycleCount = 0;
+
+    // Interpreter backend used by Run()
+    Backend backend = Backend::CHIP8_DEFAULT_BACKEND;
+
+    // CHIP-8 variant the machine behaves as, and the handlers specialized for it
+    QuirkProfile quirkProfile = QuirkProfile::Modern;
+    std::array<void (Chip8::*)(Instruction const&), OP_COUNT> const* handlerTable = nullptr;
+
+    // XO-CHIP memory, allocated while the profile is XO-CHIP so the others stay small
+    std::unique_ptr<std::array<uint8_t, XO_MEMORY_SIZE>> extendedMemory;
+
+    // Translated-code backend (Jit or Static), created when one is selected
+    std::unique_ptr<Translator> translator;
+
+    // Ring executed instructions are recorded into, if any
+    TraceRing* trace = nullptr;
+
+    // Debugger that may stop the machine, if any
+    Debugger* debugger = nullptr;
+
+    // Function pointers for opcode handling, indexed by Op; one table per quirk profile, shared by every instance
+    using Chip8Func = void (Chip8::*)(Instruction const&);
+    template <QuirkProfile P>
+    static const std::array<Chip8Func, OP_COUNT> handlers;
+
+    // Decoded instructions for program memory (START_ADDRESS up to CODE_SPACE), indexed by address
+    std::array<Instruction, CODE_SPACE - START_ADDRESS> decodeCache{};
+
+    // Decoded instruction for addresses outside the decode cache
+    Instruction uncached{};
+
+    // Execution counters; empty unless the build enables CHIP8_PROFILE
+    Profiler profiler;
 };
\ No newline at end of file
@@ -0,0 +1,259 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Chip8.hpp"
+
+// Why a debugged machine stopped
+enum class StopReason : uint8_t
+{
+    Pause,        // The controller asked it to
+    Step,         // It executed the instructions a step asked for
+    Frame,        // A new frame began after a frame step
+    Breakpoint,   // pc reached a breakpoint
+    Watchpoint    // Fx33 or Fx55 wrote a watched byte
+};
+
+// Machine state copied out of a stopped machine
+struct DebugSnapshot
+{
+    std::array<uint8_t, REGISTER_COUNT> registers{};
+    std::array<uint16_t, STACK_LEVELS> stack{};
+    std::vector<uint8_t> memory;    // The bytes Snapshot() was asked for, from its first address on
+    uint16_t pc{};
+    uint16_t index{};
+    uint8_t sp{};
+    uint8_t delayTimer{};
+    uint8_t soundTimer{};
+};
+
+/**
+ * Stops a machine at breakpoints, memory watchpoints and steps, and lets a controller on another
+ * thread inspect it while it is stopped.
+ *
+ * The machine only consults the debugger while it is attached (see Chip8::SetDebugger). Breakpoints
+ * and watched bytes are bitmaps the machine reads without locking; everything else goes through a
+ * mutex on the slow path only. A stopped machine blocks inside Run() until it is resumed or the
+ * debugger is detached.
+ */
+class Debugger
+{
+public:
+    /**
+     * @param memorySize Bytes of memory of the machines it debugs, MemorySizeOf() their profile.
+     */
+    explicit Debugger(unsigned int memorySize = MEMORY_SIZE);
+
+    /**
+     * @return The bytes of memory breakpoints and watchpoints cover.
+     */
+    unsigned int MemorySize() const { return addressMask + 1; }
+
+    /**
+     * Machine: whether the controller is attached, checked once per Run().
+     */
+    bool Attached() const { return attached.load(std::memory_order_relaxed); }
+
+    /**
+     * Machine: stops before the instruction at pc if a breakpoint, a pause or a step says so.
+     * @param chip8 The machine.
+     * @param frameStart Whether the instruction is the first one of a Run().
+     */
+    void BeforeInstruction(Chip8& chip8, bool frameStart)
+    {
+        if (Test(breakpoints, chip8.pc) || interrupt.load(std::memory_order_relaxed))
+        {
+            Break(chip8, frameStart ? Check::FrameStart : Check::Instruction, chip8.pc);
+        }
+    }
+
+    /**
+     * Machine: stops after an instruction that wrote memory if it wrote a watched byte.
+     * @param chip8 The machine, with pc past the instruction.
+     * @param address The first byte written.
+     * @param length The number of bytes written.
+     */
+    void AfterWrite(Chip8& chip8, unsigned int address, unsigned int length)
+    {
+        for (unsigned int i = 0; i < length; ++i)
+        {
+            if (Test(watched, address + i))
+            {
+                Break(chip8, Check::Write, static_cast<uint16_t>(address + i));
+                return;
+            }
+        }
+    }
+
+    /**
+     * Starts debugging: attached machines interpret every instruction from their next Run() on.
+     */
+    void Attach() { attached.store(true); }
+
+    /**
+     * Stops debugging: forgets breakpoints, watchpoints, pauses and steps, and resumes a stopped machine.
+     */
+    void Detach();
+
+    /**
+     * Sets or clears a breakpoint; the machine stops before executing the instruction there.
+     * @param address The address.
+     * @param enabled Whether to break there.
+     */
+    void SetBreakpoint(uint16_t address, bool enabled) { Set(breakpoints, address, enabled); }
+
+    /**
+     * Watches or stops watching a range of memory; the machine stops after Fx33 or Fx55 writes to it.
+     * @param first The first address.
+     * @param last The last address, included.
+     * @param enabled Whether to watch the range.
+     */
+    void SetWatchpoint(uint16_t first, uint16_t last, bool enabled);
+
+    /**
+     * Asks a running machine to stop before its next instruction.
+     */
+    void Pause();
+
+    /**
+     * Resumes a stopped machine.
+     * @param steps The number of instructions to execute before stopping again, 0 to run freely.
+     * @return false if the machine was not stopped.
+     */
+    bool Resume(unsigned int steps = 0);
+
+    /**
+     * Resumes a stopped machine until the first instruction of its next frame.
+     * @return false if the machine was not stopped.
+     */
+    bool StepFrame();
+
+    /**
+     * Returns the number of times the machine stopped so far and why it stopped last.
+     * @param reason Receives the reason of the last stop.
+     * @param address Receives the breakpoint, pc or watched byte of the last stop.
+     * @return The number of stops; unchanged means the machine did not stop again.
+     */
+    uint64_t LastStop(StopReason& reason, uint16_t& address) const;
+
+    /**
+     * Copies the state of a stopped machine, with as much of its memory as asked for.
+     * @param snapshot Receives the state.
+     * @param first The first address of memory to copy.
+     * @param count The number of bytes to copy; fewer are copied past the end of memory.
+     * @return false if the machine is not stopped.
+     */
+    bool Snapshot(DebugSnapshot& snapshot, unsigned int first = 0, unsigned int count = 0) const;
+
+private:
+    // Where the machine asks whether to stop
+    enum class Check : uint8_t { Instruction, FrameStart, Write };
+
+    // One bit per memory address
+    using AddressBitmap = std::unique_ptr<std::atomic<uint64_t>[]>;
+
+    bool Test(AddressBitmap const& bitmap, unsigned int address) const
+    {
+        address &= addressMask;
+        return (bitmap[address / 64].load(std::memory_order_relaxed) >> (address % 64)) & 1u;
+    }
+
+    void Set(AddressBitmap& bitmap, unsigned int address, bool enabled)
+    {
+        address &= addressMask;
+        uint64_t bit = uint64_t{1} << (address % 64);
+        if (enabled) bitmap[address / 64].fetch_or(bit);
+        else bitmap[address / 64].fetch_and(~bit);
+    }
+
+    // Slow path: decides whether to stop and blocks the machine until it is resumed
+    void Break(Chip8& chip8, Check check, uint16_t address);
+
+    // Keeps the machine's fast check in step with the pending requests; call with the mutex held
+    void UpdateInterrupt() { interrupt.store(pauseRequested || steps != 0 || frameStep, std::memory_order_relaxed); }
+
+    // Read by the machine without locking
+    std::atomic<bool> attached{false};
+    std::atomic<bool> interrupt{false};
+    unsigned int addressMask;
+    AddressBitmap breakpoints;
+    AddressBitmap watched;
+
+    // Requests and stops, guarded by mutex
+    mutable std::mutex mutex;
+    std::condition_variable resumed;
+    bool pauseRequested = false;
+    unsigned int steps = 0;
+    bool frameStep = false;
+    Chip8 const* stoppedMachine = nullptr;
+    StopReason stopReason = StopReason::Pause;
+    Check stopCheck = Check::Instruction;
+    uint16_t stopAddress = 0;
+    uint64_t stopCount = 0;
+};
+
+/**
+ * Controls a debugger through a local Unix-domain socket, one client at a time, so it works on hosts
+ * without a display. The debugger is attached while a client is connected.
+ *
+ * Clients send one command per line and get one line back, "ok ..." or "error ...". Whenever the
+ * machine stops, the server also sends "stopped <reason> 0x<address>". Addresses are hexadecimal:
+ *
+ *     break <addr>          delete <addr>         watch <lo>[-<hi>]      unwatch <lo>[-<hi>]
+ *     pause                 continue              step [<n>]             frame
+ *     regs                  stack                 mem <addr> [<n>]
+ */
+class DebugServer
+{
+public:
+    /**
+     * @param debugger The debugger to control, which must outlive the server.
+     */
+    explicit DebugServer(Debugger& debugger);
+
+    // Closes the socket, resuming the machine
+    ~DebugServer();
+
+    DebugServer(DebugServer const&) = delete;
+    DebugServer& operator=(DebugServer const&) = delete;
+
+    /**
+     * Creates the socket and starts accepting clients.
+     * @param path The socket's file name; an existing socket there is replaced.
+     * @return true if the socket was created.
+     */
+    bool Open(std::string const& path);
+
+    /**
+     * Waits until a client connects, e.g. to debug a run from its first instruction.
+     * @return false if the server was closed first.
+     */
+    bool WaitForClient() const;
+
+    /**
+     * Disconnects the client, detaching the debugger, and removes the socket.
+     */
+    void Close();
+
+private:
+    // Loop run by the thread: accepts clients and serves them one after the other
+    void Run();
+
+    // Serves a client until it disconnects or the server closes
+    void Serve(int client);
+
+    // Executes one command line and returns the reply
+    std::string Execute(std::string const& line);
+
+    Debugger& debugger;
+    std::string path;
+    int listener = -1;
+    std::thread thread;
+    std::atomic<bool> running{false};
+};
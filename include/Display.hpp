@@ -0,0 +1,28 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include "Chip8.hpp"
+
+constexpr uint32_t DEFAULT_ON_COLOR     = 0xFFFFFFFF;   // RGBA of a lit pixel
+constexpr uint32_t DEFAULT_OFF_COLOR    = 0x00000000;   // RGBA of an unlit pixel
+constexpr uint32_t DEFAULT_PLANE2_COLOR = 0xFF8000FF;   // RGBA of an XO-CHIP pixel lit in the second plane only
+constexpr uint32_t DEFAULT_BOTH_COLOR   = 0x804000FF;   // RGBA of an XO-CHIP pixel lit in both planes
+
+// Pixel colors indexed by plane bits: 0 unlit, 1 lit in the first plane, 2 in the second, 3 in both
+using Palette = std::array<uint32_t, 4>;
+
+constexpr Palette DEFAULT_PALETTE = {DEFAULT_OFF_COLOR, DEFAULT_ON_COLOR, DEFAULT_PLANE2_COLOR, DEFAULT_BOTH_COLOR};
+
+/**
+ * Expands rows of the bit-packed display into 32-bit RGBA pixels, in one pass.
+ * @param video The display, in either resolution.
+ * @param pixels Destination of the first expanded row, video.Width() pixels per row; a locked texture works as is.
+ * @param pitch The number of bytes between the starts of two destination rows.
+ * @param firstRow The first row to expand.
+ * @param rowCount The number of rows to expand; rows past video.Height() are ignored.
+ * @param palette The color of each combination of plane bits.
+ */
+void ExpandVideo(VideoBuffer const& video, uint32_t* pixels, int pitch,
+                 unsigned int firstRow = 0, unsigned int rowCount = HIRES_HEIGHT,
+                 Palette const& palette = DEFAULT_PALETTE);
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <utility>
+#include "Chip8.hpp"
+#include "FrameScheduler.hpp"
+#include "TripleBuffer.hpp"
+
+/**
+ * Runs a machine on its own thread in real time, paced by a FrameScheduler, so a frontend that
+ * stalls on presentation (vsync, compositor) never stalls emulation.
+ *
+ * Completed frames whose display changed are published through a lock-free triple buffer; the
+ * frontend takes the newest one whenever it is ready. Keys and the rewind switch flow the other
+ * way through atomics. While the thread runs, the machine and the scheduler belong to it.
+ */
+class EmulationThread
+{
+public:
+    /**
+     * @param chip8 The machine to run.
+     * @param scheduler The scheduler that paces it, with any rewind history or movie attached.
+     */
+    EmulationThread(Chip8& chip8, FrameScheduler& scheduler);
+
+    // Stops the thread
+    ~EmulationThread();
+
+    EmulationThread(EmulationThread const&) = delete;
+    EmulationThread& operator=(EmulationThread const&) = delete;
+
+    /**
+     * Sets a function called on the emulation thread right after each frame is published, e.g. to
+     * wake a frontend sleeping on its event queue. Set it before Start().
+     * @param listener The function, or an empty one for none.
+     */
+    void SetFrameListener(std::function<void()> listener) { frameListener = std::move(listener); }
+
+    /**
+     * Starts running the machine; its current display is published as the first frame.
+     */
+    void Start();
+
+    /**
+     * Stops running the machine and waits for the thread, returning the machine to the caller.
+     */
+    void Stop();
+
+    /**
+     * Presses or releases a key; the machine sees it from its next frame.
+     * @param key The key, 0 to F.
+     * @param pressed Whether the key is held down.
+     */
+    void SetKey(unsigned int key, bool pressed) { keys[key & (KEY_COUNT - 1)].store(pressed, std::memory_order_relaxed); }
+
+    /**
+     * Switches rewinding on or off (see FrameScheduler::SetRewinding).
+     * @param enabled Whether to rewind.
+     */
+    void SetRewinding(bool enabled) { rewinding.store(enabled, std::memory_order_relaxed); }
+
+    /**
+     * Switches fast-forward on or off: frames run back to back as fast as the host allows, and
+     * the frontend only sees the newest one whenever it presents.
+     * @param enabled Whether to fast-forward.
+     */
+    void SetTurbo(bool enabled) { turbo.store(enabled, std::memory_order_relaxed); }
+
+    /**
+     * Takes the newest published frame, if one was published since the last call.
+     * @return true if Frame() changed.
+     */
+    bool TakeFrame() { return frames.Update(); }
+
+    /**
+     * @return The frame taken last; only the thread that calls TakeFrame() may read it.
+     */
+    VideoBuffer const& Frame() const { return frames.Front(); }
+
+private:
+    // Loop run by the thread
+    void Run();
+
+    Chip8& chip8;
+    FrameScheduler& scheduler;
+
+    std::thread thread;
+    std::atomic<bool> running{false};
+
+    // Input from the frontend
+    std::array<std::atomic<uint8_t>, KEY_COUNT> keys{};
+    std::atomic<bool> rewinding{false};
+    std::atomic<bool> turbo{false};
+
+    // Frames for the frontend
+    TripleBuffer<VideoBuffer> frames;
+    std::function<void()> frameListener;
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "Chip8.hpp"
+
+class Movie;
+class Rewind;
+
+constexpr unsigned int TIMER_FREQUENCY     = 60;   // Rate of the delay/sound timers and the display, in Hz
+constexpr unsigned int MAX_CATCHUP_FRAMES  = 4;    // Frames run at most per Advance() after a host stall
+
+/**
+ * Paces emulation in fixed 60 Hz frames, independently of how fast the host loop runs.
+ *
+ * Each frame executes a configurable instruction budget and ticks the timers once,
+ * so CPU throughput and game speed are set separately from the monitor refresh rate.
+ */
+class FrameScheduler
+{
+public:
+    /**
+     * @param instructionsPerFrame The number of instructions executed per 60 Hz frame.
+     */
+    explicit FrameScheduler(unsigned int instructionsPerFrame);
+
+    /**
+     * Accounts for elapsed host time and runs every frame that has become due.
+     * @param chip8 The machine to run.
+     * @param elapsedSeconds Host time since the previous call.
+     * @return The number of frames executed; zero means there is nothing new to present.
+     */
+    unsigned int Advance(Chip8& chip8, double elapsedSeconds);
+
+    /**
+     * Runs one frame right away, whatever the time, with the same rewind and movie handling as Advance().
+     * Fast-forwarding calls this back to back instead of waiting for frames to become due.
+     * @param chip8 The machine to run.
+     */
+    void RunFrame(Chip8& chip8);
+
+    /**
+     * Scales emulated time against host time, e.g. 2 runs twice as many frames per second and
+     * 0.5 half as many. The catch-up limit after a host stall scales along.
+     * @param multiplier The speed, above zero.
+     */
+    void SetSpeed(double multiplier);
+
+    double Speed() const { return speed; }
+
+    /**
+     * @return The host time left until the next frame is due at the current speed, in seconds.
+     */
+    double TimeUntilNextFrame() const;
+
+    unsigned int InstructionsPerFrame() const { return instructionsPerFrame; }
+
+    /**
+     * Records every frame run from now on into a rewind history; null stops recording.
+     * @param history The history, which must outlive its use here.
+     */
+    void SetRewind(Rewind* history) { rewind = history; }
+
+    /**
+     * While rewinding, each due frame steps the machine back one recorded frame instead of running it.
+     * @param enabled Whether to rewind.
+     */
+    void SetRewinding(bool enabled) { rewinding = enabled; }
+
+    /**
+     * Records the keypad of every frame run from now on into a movie; null stops recording.
+     * Frames stepped back through the rewind history are dropped from it again.
+     * @param recording The movie, which must outlive its use here.
+     */
+    void SetMovie(Movie* recording) { movie = recording; }
+
+private:
+    // Instructions executed per frame
+    unsigned int instructionsPerFrame;
+
+    // Emulated time not yet consumed by whole frames
+    double accumulator{};
+
+    // Emulated seconds per host second, and the frames Advance() may run at most
+    double speed = 1.0;
+    unsigned int maxFrames = MAX_CATCHUP_FRAMES;
+
+    // Rewind history frames are recorded into and stepped back through
+    Rewind* rewind = nullptr;
+    bool rewinding = false;
+
+    // Movie the keypad of each frame is recorded into
+    Movie* movie = nullptr;
+};
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+#include "Chip8.hpp"
+#include "Translator.hpp"
+
+constexpr size_t JIT_ARENA_SIZE             = 1 << 20;  // Bytes of executable memory for translated blocks
+constexpr unsigned int JIT_MAX_BLOCK_LENGTH = 64;       // Instructions translated into one block at most
+constexpr unsigned int JIT_PAGE_SIZE        = 256;      // Bytes of memory per bucket of the invalidation index
+
+/**
+ * Dynamic recompiler that translates CHIP-8 basic blocks into x86-64 host code.
+ *
+ * A block starts at the current pc and runs until a jump, call, skip or any instruction that
+ * changes pc or writes memory. Register arithmetic (6xkk, 7xkk, 8xy*) and the jumps/skips are emitted
+ * as native code; every other instruction calls back into the interpreter's OP_* handler.
+ * Translated blocks are dropped whenever the memory they were built from is written.
+ *
+ * Only available on x86-64 Linux/macOS; elsewhere Supported() is false and Chip8 keeps interpreting.
+ */
+class Jit : public Translator
+{
+public:
+    Jit();
+    ~Jit() override;
+
+    Jit(Jit const&) = delete;
+    Jit& operator=(Jit const&) = delete;
+
+    /**
+     * @return true if this host can run translated code.
+     */
+    static bool Supported();
+
+    Backend Kind() const override { return Backend::Jit; }
+
+    /**
+     * Executes a number of CPU cycles, translating blocks as they are reached.
+     * Falls back to the interpreter for single instructions when no block can be used.
+     * @param chip8 The machine to run.
+     * @param cycles The number of instructions to execute.
+     */
+    unsigned int Run(Chip8& chip8, unsigned int cycles) override;
+
+    /**
+     * Drops translated blocks overlapping a range of memory that was just written.
+     * @param chip8 The machine whose memory was written.
+     * @param address The first address written.
+     * @param length The number of bytes written.
+     */
+    void Invalidate(Chip8 const& chip8, unsigned int address, unsigned int length) override;
+
+private:
+    // Entry point of a translated block; returns the cycle budget left over
+    using BlockFunc = unsigned int (*)(Chip8* chip8, unsigned int cycles);
+
+    struct Block
+    {
+        BlockFunc entry;
+        uint16_t start;     // Address of the first instruction
+        uint16_t end;       // One past the last byte translated
+    };
+
+    // Called from translated code to run an instruction through the interpreter
+    static void CallHandler(Chip8* chip8, Instruction const* in);
+
+    // Translates the block starting at an address; returns its index or NO_BLOCK
+    int32_t Compile(Chip8 const& chip8, uint16_t address);
+
+    // Throws away every translated block
+    void Flush();
+
+    // Executable memory holding translated code
+    uint8_t* arena = nullptr;
+    size_t arenaUsed{};
+
+    // Translated blocks and, per start address below CODE_SPACE, the index of its block (or UNCOMPILED/NO_BLOCK)
+    std::vector<Block> blocks;
+    std::array<int32_t, CODE_SPACE> blockAt{};
+
+    // Per page of code space, the blocks translated from it; entries for dropped blocks are pruned lazily
+    std::array<std::vector<int32_t>, CODE_SPACE / JIT_PAGE_SIZE> pageBlocks;
+
+    // Decoded instructions passed to interpreter callbacks; a deque keeps their addresses stable
+    std::deque<Instruction> callbacks;
+};
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include "Chip8.hpp"
+
+// GCC/Clang vector of one T per lane. Declared outside Lockstep because GCC drops a
+// dependent vector_size attribute from member typedefs used in out-of-class definitions.
+template <typename T, size_t LANES>
+struct LaneVector
+{
+    typedef T type __attribute__((vector_size(sizeof(T) * LANES)));
+};
+
+/**
+ * Runs LANES copies of one ROM in lockstep, one instruction across all lanes at a time.
+ *
+ * Machine state is stored structure-of-arrays: each register, timer, pc, stack slot and video row
+ * is a vector with one element per lane (GCC/Clang vector extensions, so the width follows the
+ * target ISA: SSE2 by default, AVX2 with -DCHIP8_AVX2=ON). Every step, the lanes sharing the most
+ * common pc and opcode execute it as vector operations under a lane mask. Lanes that have diverged
+ * take a scalar step of their own, and rejoin the vector group when their pc matches it again.
+ *
+ * Everything but Cxkk and Fx0A is vectorized. Stack, key, memory and drawing instructions are
+ * vectorized when the group agrees on the per-lane index they use (sp, I, ...), and run lane by lane
+ * otherwise. Memory is transposed too, one vector per address; addresses whose bytes differ
+ * between lanes are tracked so the shared opcode fetch stays valid under self-modifying code.
+ *
+ * Behaves like a modern-profile Chip8 with the same ROM, keys and random seed, lane for lane: opcodes
+ * go through the interpreter's Decode(), and addresses wrap at the same 4 KB of memory. Lanes only
+ * hold the 64x32 display, since the high-resolution instructions do nothing on the modern profile.
+ */
+template <size_t LANES>
+class Lockstep
+{
+public:
+    static_assert(LANES == 8 || LANES == 16 || LANES == 32, "Lockstep supports 8, 16 or 32 lanes");
+
+    Lockstep();
+
+    /**
+     * Loads a ROM image into every lane.
+     * @param data The ROM bytes.
+     * @param size The number of bytes.
+     * @return true if the ROM fits in program memory.
+     */
+    bool LoadROM(uint8_t const* data, size_t size);
+
+    /**
+     * Reseeds one lane's random number generator.
+     * @param lane The lane.
+     * @param seed The new seed.
+     */
+    void Seed(size_t lane, uint32_t seed) { random[lane].Seed(seed); }
+
+    /**
+     * Presses or releases a key on one lane.
+     * @param lane The lane.
+     * @param key The key, 0 to F.
+     * @param pressed Whether the key is held down.
+     */
+    void SetKey(size_t lane, unsigned int key, bool pressed) { keypad[key & (KEY_COUNT - 1)][lane] = pressed; }
+
+    /**
+     * Executes a number of CPU cycles on every lane.
+     * @param cycles The number of instructions each lane executes.
+     */
+    void Run(unsigned int cycles);
+
+    /**
+     * Executes one 60 Hz frame on every lane: a fixed number of CPU cycles followed by one timer tick.
+     * @param instructionsPerFrame The number of instructions to execute in the frame.
+     */
+    void RunFrame(unsigned int instructionsPerFrame);
+
+    /**
+     * Decrements every lane's delay and sound timers.
+     */
+    void TickTimers();
+
+    /**
+     * @return One lane's framebuffer.
+     */
+    VideoBuffer Video(size_t lane) const;
+
+    // Lane-steps executed in the vector group and on the scalar path, to measure divergence
+    uint64_t VectorSteps() const { return vectorSteps; }
+    uint64_t ScalarSteps() const { return scalarSteps; }
+
+private:
+    // Lane vectors, and the masks comparisons on them produce (all ones where true)
+    using U8  = typename LaneVector<uint8_t, LANES>::type;
+    using U16 = typename LaneVector<uint16_t, LANES>::type;
+    using U64 = typename LaneVector<uint64_t, LANES>::type;
+    using M8  = typename LaneVector<int8_t, LANES>::type;
+    using M16 = typename LaneVector<int16_t, LANES>::type;
+    using M64 = typename LaneVector<int64_t, LANES>::type;
+
+    // Executes one instruction on every lane
+    void Step();
+
+    // Executes an instruction on the lanes in a mask, all at the same pc; first is the lowest lane in the mask
+    void StepVector(uint16_t address, uint16_t opcode, M8 const& mask8, M16 const& mask16, size_t first);
+
+    // Fetches and executes one instruction on a single lane
+    void StepLane(size_t lane);
+
+    // Executes an instruction on a single lane whose pc has already been advanced past it
+    void ExecuteLane(size_t lane, uint16_t opcode);
+
+    // Returns the pc shared by the most lanes
+    uint16_t MajorityPc() const;
+
+    // Records whether the lanes still agree on a range of memory that was just written
+    void NoteWrite(unsigned int address, unsigned int length);
+
+    uint16_t OpcodeAt(size_t lane, unsigned int address) const
+    {
+        return static_cast<uint16_t>((memory[address & (MEMORY_SIZE - 1)][lane] << 8u) | memory[(address + 1) & (MEMORY_SIZE - 1)][lane]);
+    }
+
+    // Per-lane machine state, one vector element per lane. The default alignment of a vector depends on
+    // the ISA flags, so it is fixed here to keep the layout the same in every translation unit.
+    alignas(64) std::array<U8, REGISTER_COUNT> registers{};
+    alignas(64) std::array<U16, STACK_LEVELS> stack{};
+    alignas(64) std::array<U64, VIDEO_HEIGHT> video{};
+    alignas(64) std::array<U8, KEY_COUNT> keypad{};
+    alignas(64) U16 index{};
+    alignas(64) U16 pc{};
+    alignas(64) U8 delayTimer{};
+    alignas(64) U8 soundTimer{};
+    alignas(64) U8 sp{};
+
+    // Memory, transposed like the registers: one vector per address
+    alignas(64) std::array<U8, MEMORY_SIZE> memory{};
+
+    // Addresses whose byte is not the same in every lane
+    std::bitset<MEMORY_SIZE> divergent;
+
+    std::array<Xorshift32, LANES> random;
+
+    uint64_t vectorSteps{};
+    uint64_t scalarSteps{};
+};
+
+extern template class Lockstep<8>;
+extern template class Lockstep<16>;
+extern template class Lockstep<32>;
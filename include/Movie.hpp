@@ -0,0 +1,87 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Chip8.hpp"
+
+constexpr unsigned int MOVIE_VERSION = 2;   // Movie file format written by Movie::Save; version 1 is read as the modern profile
+
+/**
+ * Input movie: the random seed, the instructions per frame, the quirk profile, and the keypad state
+ * every frame saw.
+ *
+ * Only changes are stored, as the number of frames since the previous change and a 16-bit mask of
+ * the keys held, so a movie costs a few bytes per key press. Replaying it on a machine seeded the
+ * same way with the same ROM reproduces the recorded run exactly.
+ */
+class Movie
+{
+public:
+    /**
+     * @param seed The seed the recorded machine was given with Chip8::Seed().
+     * @param instructionsPerFrame The number of instructions per frame of the recorded run.
+     * @param quirks The quirk profile of the recorded machine.
+     */
+    explicit Movie(uint32_t seed = 0, unsigned int instructionsPerFrame = 0, QuirkProfile quirks = QuirkProfile::Modern);
+
+    /**
+     * Appends a frame, recording the keypad it runs with; call it just before the frame runs.
+     * @param keypad The keypad state.
+     */
+    void Record(std::array<uint8_t, KEY_COUNT> const& keypad);
+
+    /**
+     * Drops the newest recorded frame, to follow the machine stepping back.
+     */
+    void DropFrame();
+
+    /**
+     * Sets the keypad for the next replayed frame.
+     * @param keypad Receives the keypad state.
+     * @return false once every recorded frame has been replayed.
+     */
+    bool Play(std::array<uint8_t, KEY_COUNT>& keypad);
+
+    /**
+     * Writes the movie to a file.
+     * @param filename The path to the file.
+     * @return true if the file was written.
+     */
+    bool Save(const std::string& filename) const;
+
+    /**
+     * Reads a movie from a file, ready to replay from its first frame.
+     * @param filename The path to the file.
+     * @return true if the file was read and is a valid movie.
+     */
+    bool Load(const std::string& filename);
+
+    uint32_t Seed() const { return seed; }
+    unsigned int InstructionsPerFrame() const { return instructionsPerFrame; }
+    QuirkProfile Quirks() const { return quirks; }
+    uint64_t Frames() const { return frames; }
+
+private:
+    // The keys held from a frame onwards
+    struct Change
+    {
+        uint64_t frame;
+        uint16_t keys;
+    };
+
+    uint32_t seed;
+    unsigned int instructionsPerFrame;
+    QuirkProfile quirks;
+
+    // Frames recorded, and the keypad changes among them in frame order
+    uint64_t frames{};
+    std::vector<Change> changes;
+
+    // Replay position, and the keys held there
+    uint64_t playFrame{};
+    size_t playChange{};
+    uint16_t playKeys{};
+};
@@ -1,16 +1,19 @@
 #pragma once
 
+#include <array>
 #include <cstdint>
 #include <SDL.h>
+#include "Chip8.hpp"
+#include "Display.hpp"
 
-// The Platform class encapsulates the SDL window, OpenGL context, and rendering functionalities.
+// The Platform class encapsulates the SDL window, renderer, and the streaming texture the display is drawn into.
 class Platform
 {
 	// Granting Imgui class access to private members of Platform.
 	friend class Imgui;
 
 public:
-	// Constructor: Initializes the SDL window, OpenGL context, and textures.
+	// Constructor: Initializes the SDL window, renderer, and texture. Falls back to the software renderer without a GPU.
 	// Parameters:
 	// - title: The title of the SDL window.
 	// - windowWidth: The width of the SDL window.
@@ -22,11 +25,18 @@ public:
 	// Destructor: Cleans up and releases SDL resources.
 	~Platform();
 
-	// Updates the texture with new pixel data.
+	// Expands the changed rows of the display straight into the locked texture, then presents the frame.
+	// When the display switches resolution the texture is recreated at the new size and drawn in full.
 	// Parameters:
-	// - buffer: Pointer to the pixel data.
-	// - pitch: The number of bytes in a row of pixel data.
-	void Update(void const* buffer, int pitch);
+	// - video: The bit-packed display.
+	// - firstRow: The first row that changed.
+	// - rowCount: The number of rows that changed; 0 presents the texture as it is.
+	// - profile: The machine's execution counts, drawn as an overlay while it is toggled on; null for none.
+	void Present(VideoBuffer const& video, int firstRow, int rowCount, ProfileCounters const* profile = nullptr);
+
+	// Sets the RGBA8888 colors of lit and unlit pixels, taking effect on rows drawn from now on.
+	// Pixels lit in the second XO-CHIP plane keep their default colors.
+	void SetPalette(uint32_t on, uint32_t off) { palette[1] = on; palette[0] = off; }
 
 	// Processes input events and updates the state of the keys.
 	// Parameters:
@@ -35,19 +45,78 @@ public:
 	// - true if the application should continue running, false if it should quit.
 	bool ProcessInput(uint8_t* keys);
 
+	// Sleeps until an input or wake event is queued, or the timeout passes; ProcessInput() then handles it.
+	// Parameters:
+	// - timeoutMs: The longest time to sleep, in milliseconds.
+	void WaitForEvent(int timeoutMs);
+
+	// Wakes a thread sleeping in WaitForEvent(). Safe to call from any thread.
+	static void Wake();
+
+	// Returns whether the rewind key (Backspace) is held down.
+	bool RewindHeld() const { return rewindHeld; }
+
+	// Returns whether the profiler overlay is on; F1 toggles it.
+	bool OverlayOn() const { return overlayOn; }
+
+	// Returns whether fast-forward is on; Tab toggles it.
+	bool TurboOn() const { return turbo; }
+
+	// Returns the refresh rate of the display the window is on, in Hz; 60 if unknown.
+	int RefreshRate() const;
+
+	// Returns whether the window must be presented again even if the frame did not change.
+	bool RedrawNeeded() const { return redrawNeeded; }
+
 private:
-	// Pointer to the SDL window.
-	SDL_Window* window = nullptr;
+	// Draws the profiler overlay: the hits of every address below CODE_SPACE as a 64 x 64 heatmap over the window,
+	// one bar per handler along the bottom, and instructions and frames per second in the corner.
+	void DrawOverlay(ProfileCounters const& profile);
 
-	// Handle to the OpenGL context.
-	SDL_GLContext gl_context = nullptr;
+	// Draws a decimal number with the CHIP-8 digit sprites.
+	// Parameters:
+	// - value: The number.
+	// - x, y: The top left corner, in window pixels.
+	// - scale: The size of one sprite pixel, in window pixels.
+	void DrawNumber(uint64_t value, int x, int y, int scale);
 
-	// Pointer to the SDL texture used as a framebuffer.
-    SDL_Texture* framebuffer_texture = nullptr;
+	// Pointer to the SDL window.
+	SDL_Window* window = nullptr;
 
 	// Pointer to the SDL renderer.
 	SDL_Renderer* renderer = nullptr;
 
 	// Pointer to the SDL texture used for rendering.
 	SDL_Texture* texture = nullptr;
+
+	// Size of the texture in pixels.
+	int textureWidth = 0;
+	int textureHeight = 0;
+
+	// Pixel colors by plane bits.
+	Palette palette = DEFAULT_PALETTE;
+
+	// Whether the rewind key is held down.
+	bool rewindHeld = false;
+
+	// Whether fast-forward is toggled on.
+	bool turbo = false;
+
+	// Whether the profiler overlay is toggled on.
+	bool overlayOn = false;
+
+	// Heatmap texture, one pixel per address, created when the overlay is first drawn.
+	SDL_Texture* heatmap = nullptr;
+
+	// Counts at the previous overlay sample, and what changed since the one before it.
+	Uint32 sampleTicks = 0;
+	std::array<uint64_t, CODE_SPACE> sampleHits{};
+	std::array<uint64_t, OP_COUNT> sampleOps{};
+	std::array<uint64_t, OP_COUNT> opsDelta{};
+	uint64_t sampleFrames = 0;
+	uint64_t instructionsPerSecond = 0;
+	uint64_t framesPerSecond = 0;
+
+	// Whether the window was uncovered or resized since the last presented frame.
+	bool redrawNeeded = true;
 };
\ No newline at end of file
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Chip8.hpp"
+
+constexpr size_t       REWIND_DEFAULT_BUDGET    = 4u << 20;   // Bytes of history kept by default
+constexpr unsigned int REWIND_KEYFRAME_INTERVAL = 60;         // Frames between full snapshots
+constexpr size_t       REWIND_BYTES_PER_FRAME   = 128;        // Budget per entry of the frame index; deltas average about 100 bytes
+
+/**
+ * Rewind history: one save state per emulated frame, kept in a ring of fixed size.
+ *
+ * Every keyframeInterval frames a full save state is stored as a keyframe, run-length encoded since
+ * most of memory is usually zero. The frames in between are stored as the XOR of their state with
+ * the keyframe's, run-length encoded, which for most frames is a few dozen bytes; a frame that
+ * changed too much to compress becomes a keyframe.
+ * All memory is allocated up front, and the oldest frames are dropped to stay within the budget.
+ *
+ * Restoring a frame decodes one delta against one keyframe, so stepping back costs the same
+ * however long the session has run.
+ */
+class Rewind
+{
+public:
+    /**
+     * @param budget Bytes of memory for the history, frame index and state buffers included;
+     *               at least the buffers plus four save states, at most 4 GiB.
+     * @param keyframeInterval Frames between keyframes.
+     */
+    explicit Rewind(size_t budget = REWIND_DEFAULT_BUDGET, unsigned int keyframeInterval = REWIND_KEYFRAME_INTERVAL);
+
+    /**
+     * Records the state of a machine; call it once after every frame.
+     * @param chip8 The machine.
+     */
+    void Push(Chip8 const& chip8);
+
+    /**
+     * Steps back one frame: drops the newest recorded frame and restores the one before it.
+     * @param chip8 The machine to restore.
+     * @return false if there is no earlier frame, leaving the machine unchanged.
+     */
+    bool StepBack(Chip8& chip8);
+
+    /**
+     * Drops the whole history.
+     */
+    void Clear();
+
+    // Number of frames recorded
+    size_t Frames() const { return count; }
+
+    // Bytes of recorded frames in the ring, out of RingCapacity()
+    size_t BytesUsed() const { return used; }
+    size_t RingCapacity() const { return ring.size(); }
+
+private:
+    // A recorded frame: where its bytes are in the ring, and the frame holding its keyframe
+    struct Entry
+    {
+        uint64_t keyframe;
+        uint32_t offset;
+        uint32_t size;
+    };
+
+    Entry& At(uint64_t frame) { return entries[frame % entries.size()]; }
+
+    // Returns where a record of some size can be written, dropping old frames until it fits
+    size_t Allocate(size_t size);
+
+    // Drops the oldest frame, and the deltas that depended on it if it was a keyframe
+    void DropOldest();
+
+    // Encodes the XOR of a state with a reference state; returns 0 if it would not fit in the limit
+    size_t Encode(SaveStateBuffer const& state, SaveStateBuffer const& reference, uint8_t* out, size_t limit) const;
+
+    // Encodes the scratch state as a keyframe into delta; returns the record size, stateSize if stored raw
+    size_t EncodeKeyframe();
+
+    // Rebuilds a frame's state from its record
+    void Decode(uint64_t frame, SaveStateBuffer& state);
+
+    unsigned int keyframeInterval;
+
+    // Bytes in the save states of the machine being recorded
+    size_t stateSize = SAVE_STATE_SIZE;
+
+    // Recorded frames, oldest first; entry n of the history is frame first + n
+    std::vector<Entry> entries;
+    uint64_t first{};
+    size_t count{};
+
+    // Frame records, stored contiguously; a record that does not fit before the end wraps to the start
+    std::vector<uint8_t> ring;
+    size_t used{};
+
+    // The newest keyframe and its state, which new deltas are encoded against
+    uint64_t keyframe{};
+    SaveStateBuffer keyframeState{};
+
+    // Scratch space for Push() and StepBack()
+    SaveStateBuffer scratch{};
+    SaveStateBuffer delta{};
+};
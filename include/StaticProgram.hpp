@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Chip8.hpp"
+#include "Translator.hpp"
+
+// A basic block of a ROM recompiled ahead of time into a C++ function.
+// The function runs at most `cycles` instructions starting at `start` and returns the budget left over.
+struct StaticBlock
+{
+    uint16_t start;     // Address of the first instruction
+    uint16_t end;       // One past the last byte translated
+    unsigned int (*run)(Chip8& chip8, unsigned int cycles);
+};
+
+// A ROM and the blocks chip8-recompile generated for it, sorted by start address
+struct StaticProgram
+{
+    uint8_t const* rom;
+    size_t romSize;
+    StaticBlock const* blocks;
+    size_t blockCount;
+    QuirkProfile quirks;    // The quirks the blocks implement; machines with others interpret instead
+};
+
+/**
+ * Access to Chip8 state for recompiled code. Generated functions only go through here,
+ * so they build against the same private state the interpreter uses.
+ */
+struct StaticRuntime
+{
+    static uint8_t* Registers(Chip8& chip8) { return chip8.registers.data(); }
+    static uint16_t* Stack(Chip8& chip8) { return chip8.stack.data(); }
+    static uint16_t& Pc(Chip8& chip8) { return chip8.pc; }
+    static uint16_t& Index(Chip8& chip8) { return chip8.index; }
+    static uint8_t& Sp(Chip8& chip8) { return chip8.sp; }
+
+    /**
+     * Runs one instruction through its interpreter handler, with pc already past it as in Cycle().
+     * Used for the instructions recompiled code does not implement itself.
+     * @param chip8 The machine to run.
+     * @param address The address of the instruction.
+     */
+    static void Execute(Chip8& chip8, uint16_t address)
+    {
+        Instruction const& in = chip8.Fetch(address);
+        chip8.pc = address + 2;
+        chip8.Execute(in);
+    }
+};
+
+/**
+ * Backend that runs a statically recompiled program.
+ *
+ * Blocks are only used while memory still holds the ROM bytes they were generated from and the
+ * machine has the quirks they were generated for; anything else (Bnnn targets, self-modified code, addresses the CFG walk never reached)
+ * is interpreted one instruction at a time.
+ */
+class StaticRunner : public Translator
+{
+public:
+    /**
+     * @param program The recompiled program.
+     * @param chip8 The machine it will run on, whose memory is checked against the program's ROM.
+     */
+    StaticRunner(StaticProgram const& program, Chip8 const& chip8);
+
+    Backend Kind() const override { return Backend::Static; }
+
+    unsigned int Run(Chip8& chip8, unsigned int cycles) override;
+
+    void Invalidate(Chip8 const& chip8, unsigned int address, unsigned int length) override;
+
+private:
+    // Enables each block overlapping a range whose memory still matches the ROM, and disables the others
+    void Validate(Chip8 const& chip8, unsigned int address, unsigned int length);
+
+    StaticProgram const& program;
+
+    // Per address of the program's memory, the index of the block starting there, or -1
+    std::vector<int32_t> blockAt;
+};
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+constexpr unsigned int CHUNKS_PER_WORKER = 8;  // Ranges a parallel loop is split into per worker, so idle workers have something to steal
+
+/**
+ * Fixed set of worker threads running parallel loops with work stealing.
+ *
+ * ParallelFor() splits an index range into chunks and deals them out to per-worker queues.
+ * Each worker drains its own queue from the back and, once empty, steals from the front of the others,
+ * so uneven per-index cost (machines stuck waiting for a key versus drawing every frame)
+ * still keeps every core busy until the loop is done.
+ */
+class ThreadPool
+{
+public:
+    /**
+     * @param threadCount The number of threads running loops, including the caller; 0 uses every hardware thread.
+     */
+    explicit ThreadPool(unsigned int threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(ThreadPool const&) = delete;
+    ThreadPool& operator=(ThreadPool const&) = delete;
+
+    /**
+     * Calls body(begin, end) over disjoint ranges covering [0, count) and returns once all have finished.
+     * The calling thread works through ranges too. Not reentrant.
+     * @param count The number of indices.
+     * @param body The function run on each range.
+     */
+    void ParallelFor(size_t count, std::function<void(size_t begin, size_t end)> const& body);
+
+    unsigned int ThreadCount() const { return static_cast<unsigned int>(queues.size()); }
+
+private:
+    struct Range
+    {
+        size_t begin;
+        size_t end;
+        std::function<void(size_t, size_t)> const* body;
+    };
+
+    // One worker's ranges; the owner pops from the back, thieves take from the front
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Range> ranges;
+    };
+
+    // Loop run by each background thread; worker 0 is the caller of ParallelFor()
+    void WorkerLoop(unsigned int worker);
+
+    // Runs one range from this worker's queue or a stolen one; returns false if every queue was empty
+    bool RunOne(unsigned int worker);
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+
+    // Wakes workers when a loop starts and the caller when its last range finishes
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    uint64_t generation{};
+    bool stopping = false;
+
+    // Ranges of the current loop not yet finished
+    std::atomic<size_t> pending{};
+};
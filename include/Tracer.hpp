@@ -0,0 +1,205 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Chip8.hpp"
+
+constexpr unsigned int TRACE_VERSION          = 2;          // Trace file format written by TraceWriter
+constexpr uint16_t     TRACE_GAP              = 0xFFFF;     // Record pc marking records dropped while the ring was full
+constexpr size_t       TRACE_DEFAULT_CAPACITY = 1u << 20;   // Records a ring holds by default (24 MiB)
+
+/**
+ * One executed instruction: where it ran, what it was, I and the registers it changed.
+ *
+ * Records are fixed-width so the ring and the file are plain arrays of them. A gap marker
+ * (pc == TRACE_GAP) stands for records dropped in between and holds their number in values.
+ */
+struct TraceRecord
+{
+    uint16_t pc;                                // Address of the instruction
+    uint16_t opcode;                            // The instruction word
+    uint16_t index;                             // I after the instruction
+    uint16_t changed;                           // Bit n is set if the instruction changed Vn
+    std::array<uint8_t, REGISTER_COUNT> values; // New values of the changed registers, lowest first
+};
+
+static_assert(sizeof(TraceRecord) == 24, "trace records are written to files as they are");
+
+/**
+ * Lock-free ring of trace records from one machine's thread (the producer) to one reader.
+ *
+ * The producer never waits: while the ring is full, records are counted instead of stored and
+ * a gap marker takes their place once there is room again. Records become visible to the
+ * reader at the end of every Run() and every few thousand records within one.
+ */
+class TraceRing
+{
+public:
+    /**
+     * @param capacity The number of records held, rounded up to a power of two.
+     */
+    explicit TraceRing(size_t capacity = TRACE_DEFAULT_CAPACITY);
+
+    /**
+     * Producer: appends the record of an executed instruction.
+     * @param pc The address of the instruction.
+     * @param opcode The instruction word.
+     * @param index I after the instruction.
+     * @param before The registers before the instruction.
+     * @param after The registers after it.
+     */
+    void Record(uint16_t pc, uint16_t opcode, uint16_t index,
+                std::array<uint8_t, REGISTER_COUNT> const& before, std::array<uint8_t, REGISTER_COUNT> const& after)
+    {
+        // A gap marker goes first if records were dropped
+        if (!Reserve(dropped != 0 ? 2 : 1))
+        {
+            ++dropped;
+            return;
+        }
+
+        if (dropped != 0)
+        {
+            TraceRecord& gap = slots[head++ & mask];
+            gap = TraceRecord{TRACE_GAP, 0, 0, 0, {}};
+            std::memcpy(gap.values.data(), &dropped, sizeof(dropped));
+            dropped = 0;
+        }
+
+        // Built whole and stored with one write; changed registers are visited lowest first
+        TraceRecord record{pc, opcode, index, ChangedMask(before, after), {}};
+        unsigned int count = 0;
+        for (unsigned int bits = record.changed; bits != 0; bits &= bits - 1)
+        {
+            record.values[count++] = after[__builtin_ctz(bits)];
+        }
+        slots[head++ & mask] = record;
+
+        if ((head & (PUBLISH_INTERVAL - 1)) == 0) Publish();
+    }
+
+    /**
+     * Producer: makes every record appended so far visible to the reader.
+     */
+    void Publish() { published.store(head, std::memory_order_release); }
+
+    /**
+     * Reader: returns the oldest unread records that are contiguous in the ring.
+     * @param count Receives the number of records, 0 if there are none.
+     * @return The first record.
+     */
+    TraceRecord const* Peek(size_t& count) const
+    {
+        uint64_t available = published.load(std::memory_order_acquire) - tail;
+        size_t offset = static_cast<size_t>(tail & mask);
+        count = static_cast<size_t>(std::min<uint64_t>(available, slots.size() - offset));
+        return slots.data() + offset;
+    }
+
+    /**
+     * Reader: releases records returned by Peek() for the producer to reuse.
+     * @param count The number of records read.
+     */
+    void Consume(size_t count)
+    {
+        tail += count;
+        consumed.store(tail, std::memory_order_release);
+    }
+
+private:
+    // Records appended between publications within one Run()
+    static constexpr uint64_t PUBLISH_INTERVAL = 4096;
+
+    // Whether there is room for a number of records, re-reading the reader's position only when needed
+    bool Reserve(uint64_t count)
+    {
+        if (head + count - consumedCache <= slots.size()) return true;
+        consumedCache = consumed.load(std::memory_order_acquire);
+        return head + count - consumedCache <= slots.size();
+    }
+
+    // Bit n set where Vn differs, eight registers per word
+    static uint16_t ChangedMask(std::array<uint8_t, REGISTER_COUNT> const& before, std::array<uint8_t, REGISTER_COUNT> const& after)
+    {
+        uint16_t result = 0;
+        for (unsigned int half = 0; half < 2; ++half)
+        {
+            uint64_t a, b;
+            std::memcpy(&a, before.data() + 8 * half, 8);
+            std::memcpy(&b, after.data() + 8 * half, 8);
+            uint64_t diff = a ^ b;
+
+            // High bit of each byte set if the byte is nonzero, then gathered into the low byte
+            uint64_t nonzero = (((diff & 0x7F7F7F7F7F7F7F7Full) + 0x7F7F7F7F7F7F7F7Full) | diff) & 0x8080808080808080ull;
+            result |= static_cast<uint16_t>(((nonzero >> 7) * 0x0102040810204080ull) >> 56) << (8 * half);
+        }
+        return result;
+    }
+
+    std::vector<TraceRecord> slots;
+    uint64_t mask;
+
+    // Producer side: next slot to write, records dropped since the last one stored, last position of the reader seen
+    alignas(64) uint64_t head = 0;
+    uint64_t dropped = 0;
+    uint64_t consumedCache = 0;
+    std::atomic<uint64_t> published{0};
+
+    // Reader side
+    alignas(64) uint64_t tail = 0;
+    std::atomic<uint64_t> consumed{0};
+};
+
+/**
+ * Streams a trace ring to a binary file on a background thread, so the machine never waits on I/O.
+ *
+ * The file holds a header ("C8TR", TRACE_VERSION and the record size as little-endian 32-bit words)
+ * followed by the records in the order they were executed, in host byte order.
+ */
+class TraceWriter
+{
+public:
+    /**
+     * @param ring The ring to read, which must outlive the writer.
+     */
+    explicit TraceWriter(TraceRing& ring);
+
+    // Writes what is left in the ring and closes the file
+    ~TraceWriter();
+
+    TraceWriter(TraceWriter const&) = delete;
+    TraceWriter& operator=(TraceWriter const&) = delete;
+
+    /**
+     * Creates the file, writes the header and starts streaming.
+     * @param filename The file to write.
+     * @return true if the file was created.
+     */
+    bool Open(std::string const& filename);
+
+    /**
+     * Writes every record published so far and closes the file. Call it once the machine stopped.
+     * @return true if everything was written.
+     */
+    bool Close();
+
+private:
+    // Loop run by the thread
+    void Run();
+
+    // Writes every record available now
+    void Drain();
+
+    TraceRing& ring;
+    std::ofstream file;
+    std::thread thread;
+    std::atomic<bool> running{false};
+};
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "Chip8.hpp"
+
+/**
+ * Common interface of the backends that run translated code instead of interpreting,
+ * so Chip8 can own either one and tell it about writes to code memory.
+ */
+class Translator
+{
+public:
+    virtual ~Translator() = default;
+
+    /**
+     * @return The backend this translator implements.
+     */
+    virtual Backend Kind() const = 0;
+
+    /**
+     * Executes exactly a number of CPU cycles, interpreting wherever no translated code applies.
+     * @param chip8 The machine to run.
+     * @param cycles The number of instructions to execute.
+     * @return The cycles not executed: those an idle-loop skip ran off, or the rest once Fx0A halts.
+     */
+    virtual unsigned int Run(Chip8& chip8, unsigned int cycles) = 0;
+
+    /**
+     * Called after memory was written, so translations of the old bytes stop being used.
+     * @param chip8 The machine whose memory was written.
+     * @param address The first address written.
+     * @param length The number of bytes written.
+     */
+    virtual void Invalidate(Chip8 const& chip8, unsigned int address, unsigned int length) = 0;
+};
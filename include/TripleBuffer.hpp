@@ -0,0 +1,63 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+/**
+ * Lock-free handoff of values from one producer thread to one consumer thread, newest value wins.
+ *
+ * Three slots rotate between the producer (back), the handoff (middle) and the consumer (front).
+ * Publishing swaps the back slot into the middle and reading swaps the middle into the front,
+ * each with one atomic exchange, so neither side ever waits for the other. Values the consumer
+ * was too slow to take are overwritten.
+ */
+template <typename T>
+class TripleBuffer
+{
+public:
+    /**
+     * @return The slot the producer fills before calling Publish().
+     */
+    T& Back() { return slots[back]; }
+
+    /**
+     * Hands the back slot to the consumer and takes a free slot to write next.
+     * @return true if the consumer had taken the previous value, false if this one replaced it unseen.
+     */
+    bool Publish()
+    {
+        uint8_t previous = middle.exchange(static_cast<uint8_t>(back | FRESH), std::memory_order_acq_rel);
+        back = previous & INDEX;
+        return !(previous & FRESH);
+    }
+
+    /**
+     * Takes the newest published value, if there is one the consumer has not seen.
+     * @return true if Front() changed.
+     */
+    bool Update()
+    {
+        if (!(middle.load(std::memory_order_relaxed) & FRESH)) return false;
+
+        front = middle.exchange(front, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+
+    /**
+     * @return The value the consumer took last.
+     */
+    T const& Front() const { return slots[front]; }
+
+private:
+    // The middle index carries a flag telling whether it holds a value the consumer has not taken
+    static constexpr uint8_t INDEX = 0x3;
+    static constexpr uint8_t FRESH = 0x4;
+
+    std::array<T, 3> slots{};
+
+    // Each side's index on its own cache line, so publishing and reading do not contend
+    alignas(64) uint8_t back = 0;
+    alignas(64) std::atomic<uint8_t> middle{1};
+    alignas(64) uint8_t front = 2;
+};
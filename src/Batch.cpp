@@ -0,0 +1,144 @@
+#include "../include/Batch.hpp"
+#include <fstream>
+#include <iterator>
+
+/**
+ * @brief Constructs the machines and the thread pool that steps them.
+ *
+ * @param machineCount The number of machines.
+ * @param threadCount The number of threads stepping them; 0 uses every hardware thread.
+ */
+Batch::Batch(size_t machineCount, unsigned int threadCount)
+	: machines(machineCount), pool(threadCount)
+{
+}
+
+/**
+ * @brief Loads the same ROM file into every machine, reading it once.
+ *
+ * @param filename The path to the ROM file.
+ * @return true if the ROM was read and fits in program memory.
+ */
+bool Batch::LoadROM(const std::string& filename)
+{
+	std::ifstream file(filename, std::ios::binary);
+
+	if (!file.is_open()) return false;
+
+	std::vector<uint8_t> buffer((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	if (file.bad()) return false;
+
+	return LoadROM(buffer.data(), buffer.size());
+}
+
+/**
+ * @brief Loads a ROM image into every machine.
+ *
+ * @param data The ROM bytes.
+ * @param size The number of bytes.
+ * @return true if the ROM fits in program memory.
+ */
+bool Batch::LoadROM(uint8_t const* data, size_t size)
+{
+	if (!machines.empty() && size > RomCapacity(machines.front().GetQuirks())) return false;
+
+	pool.ParallelFor(machines.size(), [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i)
+		{
+			machines[i].LoadROM(data, size);
+		}
+	});
+
+	return true;
+}
+
+/**
+ * @brief Runs a number of 60 Hz frames on every machine, in parallel.
+ *
+ * Each range of machines runs all of its frames before moving on, so a machine's
+ * state stays in one core's cache for the whole call.
+ *
+ * @param frames The number of frames to run.
+ * @param instructionsPerFrame The number of instructions per frame.
+ */
+void Batch::RunFrames(unsigned int frames, unsigned int instructionsPerFrame)
+{
+	pool.ParallelFor(machines.size(), [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i)
+		{
+			for (unsigned int frame = 0; frame < frames; ++frame)
+			{
+				machines[i].RunFrame(instructionsPerFrame);
+			}
+		}
+	});
+}
+
+/**
+ * @brief Selects the interpreter backend of every machine.
+ *
+ * @param backend The backend to use from now on.
+ */
+void Batch::SetBackend(Backend backend)
+{
+	for (Chip8& machine : machines)
+	{
+		machine.SetBackend(backend);
+	}
+}
+
+/**
+ * @brief Selects the quirk profile of every machine.
+ *
+ * @param profile The profile to use from now on.
+ */
+void Batch::SetQuirks(QuirkProfile profile)
+{
+	for (Chip8& machine : machines)
+	{
+		machine.SetQuirks(profile);
+	}
+}
+
+/**
+ * @brief Seeds every machine's random number generator, machine i with seed + i.
+ *
+ * @param seed The seed of the first machine.
+ */
+void Batch::Seed(uint32_t seed)
+{
+	for (size_t i = 0; i < machines.size(); ++i)
+	{
+		machines[i].Seed(seed + static_cast<uint32_t>(i));
+	}
+}
+
+/**
+ * @brief Sums the instructions every machine has executed.
+ *
+ * @return The total.
+ */
+uint64_t Batch::InstructionCount() const
+{
+	uint64_t total = 0;
+	for (Chip8 const& machine : machines)
+	{
+		total += machine.InstructionCount();
+	}
+	return total;
+}
+
+/**
+ * @brief Sums the cycles every machine's idle-loop skipping ran off.
+ *
+ * @return The total.
+ */
+uint64_t Batch::SkippedCycleCount() const
+{
+	uint64_t total = 0;
+	for (Chip8 const& machine : machines)
+	{
+		total += machine.SkippedCycleCount();
+	}
+	return total;
+}
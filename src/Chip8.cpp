@@ -1,13 +1,17 @@
 #include "../include/Chip8.hpp"
+#include "../include/Debugger.hpp"
+#include "../include/Jit.hpp"
+#include "../include/StaticProgram.hpp"
+#include "../include/Tracer.hpp"
 #include <fstream>
 #include <random>
+#include <vector>
 #include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
 
-constexpr unsigned int FONTSET_SIZE = 80;
-constexpr unsigned int FONTSET_START_ADDRESS = 0x50;
-constexpr unsigned int START_ADDRESS = 0x200;
-
-std::array<uint8_t, FONTSET_SIZE> fontset = {
+const std::array<uint8_t, FONTSET_SIZE> fontset = {
 	0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
 	0x20, 0x60, 0x20, 0x20, 0x70, // 1
 	0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
@@ -26,91 +30,286 @@ std::array<uint8_t, FONTSET_SIZE> fontset = {
 	0xF0, 0x80, 0xF0, 0x80, 0x80  // F
 };
 
+const std::array<uint8_t, BIGFONT_SIZE> bigFontset = {
+	0xFF, 0xFF, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, // 0
+	0x18, 0x78, 0x78, 0x18, 0x18, 0x18, 0x18, 0x18, 0xFF, 0xFF, // 1
+	0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // 2
+	0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 3
+	0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0x03, 0x03, // 4
+	0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 5
+	0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, // 6
+	0xFF, 0xFF, 0x03, 0x03, 0x06, 0x0C, 0x18, 0x18, 0x18, 0x18, // 7
+	0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, // 8
+	0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 9
+	0x7E, 0xFF, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3, // A
+	0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, // B
+	0x3C, 0xFF, 0xC3, 0xC0, 0xC0, 0xC0, 0xC0, 0xC3, 0xFF, 0x3C, // C
+	0xFC, 0xFE, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFE, 0xFC, // D
+	0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // E
+	0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xC0, 0xC0  // F
+};
+
+const std::array<char const*, OP_COUNT> opNames = {
+	"OP_NULL", "OP_00E0", "OP_00EE", "OP_1nnn", "OP_2nnn", "OP_3xkk", "OP_4xkk", "OP_5xy0",
+	"OP_6xkk", "OP_7xkk", "OP_8xy0", "OP_8xy1", "OP_8xy2", "OP_8xy3", "OP_8xy4", "OP_8xy5",
+	"OP_8xy6", "OP_8xy7", "OP_8xyE", "OP_9xy0", "OP_Annn", "OP_Bnnn", "OP_Cxkk", "OP_Dxyn",
+	"OP_Ex9E", "OP_ExA1", "OP_Fx07", "OP_Fx0A", "OP_Fx15", "OP_Fx18", "OP_Fx1E", "OP_Fx29",
+	"OP_Fx33", "OP_Fx55", "OP_Fx65", "OP_00Cn", "OP_00Dn", "OP_00FB", "OP_00FC", "OP_00FD",
+	"OP_00FE", "OP_00FF", "OP_5xy2", "OP_5xy3", "OP_F000", "OP_Fn01", "OP_F002", "OP_Fx30",
+	"OP_Fx3A", "OP_Fx75", "OP_Fx85"
+};
+
+namespace
+{
+	// Decode tables mapping opcode bits to Op. Opcodes starting with 0x0, 0x8, 0xE and 0xF
+	// are resolved through their second-level table; the nibble tables cover all 16 values of n, and
+	// unlisted entries are OP_NULL. The SUPER-CHIP and XO-CHIP opcodes decode on every profile,
+	// and their handlers know what the profile supports.
+	constexpr std::array<Op, 0xF + 1> table = {
+		Op::OP_NULL, Op::OP_1nnn, Op::OP_2nnn, Op::OP_3xkk,
+		Op::OP_4xkk, Op::OP_5xy0, Op::OP_6xkk, Op::OP_7xkk,
+		Op::OP_NULL, Op::OP_9xy0, Op::OP_Annn, Op::OP_Bnnn,
+		Op::OP_Cxkk, Op::OP_Dxyn, Op::OP_NULL, Op::OP_NULL
+	};
+
+	constexpr std::array<Op, 0xF + 1> MakeTable0()
+	{
+		std::array<Op, 0xF + 1> t{};
+		t[0x0] = Op::OP_00E0;
+		t[0xE] = Op::OP_00EE;
+		return t;
+	}
+
+	// 00FB-00FF, indexed by n - 0xB
+	constexpr std::array<Op, 5> table00F = {
+		Op::OP_00FB, Op::OP_00FC, Op::OP_00FD, Op::OP_00FE, Op::OP_00FF
+	};
+
+	constexpr std::array<Op, 0xF + 1> MakeTable8()
+	{
+		std::array<Op, 0xF + 1> t{};
+		t[0x0] = Op::OP_8xy0;
+		t[0x1] = Op::OP_8xy1;
+		t[0x2] = Op::OP_8xy2;
+		t[0x3] = Op::OP_8xy3;
+		t[0x4] = Op::OP_8xy4;
+		t[0x5] = Op::OP_8xy5;
+		t[0x6] = Op::OP_8xy6;
+		t[0x7] = Op::OP_8xy7;
+		t[0xE] = Op::OP_8xyE;
+		return t;
+	}
+
+	constexpr std::array<Op, 0xF + 1> MakeTableE()
+	{
+		std::array<Op, 0xF + 1> t{};
+		t[0x1] = Op::OP_ExA1;
+		t[0xE] = Op::OP_Ex9E;
+		return t;
+	}
+
+	constexpr std::array<Op, 0x85 + 1> MakeTableF()
+	{
+		std::array<Op, 0x85 + 1> t{};
+		t[0x00] = Op::OP_F000;
+		t[0x01] = Op::OP_Fn01;
+		t[0x02] = Op::OP_F002;
+		t[0x07] = Op::OP_Fx07;
+		t[0x0A] = Op::OP_Fx0A;
+		t[0x15] = Op::OP_Fx15;
+		t[0x18] = Op::OP_Fx18;
+		t[0x1E] = Op::OP_Fx1E;
+		t[0x29] = Op::OP_Fx29;
+		t[0x30] = Op::OP_Fx30;
+		t[0x33] = Op::OP_Fx33;
+		t[0x3A] = Op::OP_Fx3A;
+		t[0x55] = Op::OP_Fx55;
+		t[0x65] = Op::OP_Fx65;
+		t[0x75] = Op::OP_Fx75;
+		t[0x85] = Op::OP_Fx85;
+		return t;
+	}
+
+	constexpr std::array<Op, 0xF + 1> table0 = MakeTable0();
+	constexpr std::array<Op, 0xF + 1> table8 = MakeTable8();
+	constexpr std::array<Op, 0xF + 1> tableE = MakeTableE();
+	constexpr std::array<Op, 0x85 + 1> tableF = MakeTableF();
+
+	static_assert(Op{} == Op::OP_NULL, "value-initialized decode table entries must mean OP_NULL");
+
+	// Looks up the Op an opcode executes as
+	Op OpFor(uint16_t opcode)
+	{
+		uint8_t n = opcode & 0x000Fu;
+		uint8_t kk = opcode & 0x00FFu;
+		switch ((opcode & 0xF000u) >> 12u)
+		{
+			case 0x0:
+				if ((opcode & 0x0FF0u) == 0x00C0u) return Op::OP_00Cn;
+				if ((opcode & 0x0FF0u) == 0x00D0u) return Op::OP_00Dn;
+				if ((opcode & 0x0FF0u) == 0x00F0u && n >= 0xB) return table00F[n - 0xB];
+				return table0[n];
+			case 0x5: return n == 0x2 ? Op::OP_5xy2 : n == 0x3 ? Op::OP_5xy3 : Op::OP_5xy0;
+			case 0x8: return table8[n];
+			case 0xE: return tableE[n];
+			case 0xF:
+				// F000 and F002 take no register
+				if (kk <= 0x02 && kk != 0x01 && (opcode & 0x0F00u)) return Op::OP_NULL;
+				return kk < tableF.size() ? tableF[kk] : Op::OP_NULL;
+			default:  return table[(opcode & 0xF000u) >> 12u];
+		}
+	}
+
+	// Save states start with a magic number, the format version and the memory size, which sets their
+	// length. The fields follow in a fixed order, multi-byte values little-endian: random generator
+	// state, pc, I, sp, delay and sound timers, registers, stack, resolution, plane mask, pitch, flag
+	// registers, audio pattern, video planes and memory.
+	constexpr std::array<uint8_t, 4> SAVE_STATE_MAGIC = {'C', '8', 'S', 'S'};
+
+	static_assert(SAVE_STATE_SIZE == SAVE_STATE_MAGIC.size() + 4 + 4 + 4 + 2 + 2 + 3 + REGISTER_COUNT
+		+ 2 * STACK_LEVELS + 3 + FLAG_REGISTER_COUNT + AUDIO_PATTERN_SIZE + 8 * VIDEO_PLANES * VIDEO_PLANE_WORDS
+		+ MEMORY_SIZE, "SAVE_STATE_SIZE must match the save-state layout");
+	static_assert(XO_SAVE_STATE_SIZE == SaveStateSizeOf(QuirkProfile::XoChip), "SaveStateBuffer must hold every profile's state");
+
+	template <typename T>
+	uint8_t* Put(uint8_t* out, T value)
+	{
+		for (size_t i = 0; i < sizeof(T); ++i)
+		{
+			*out++ = static_cast<uint8_t>(value >> (8 * i));
+		}
+		return out;
+	}
+
+	template <typename T>
+	T Get(uint8_t const*& in)
+	{
+		T value = 0;
+		for (size_t i = 0; i < sizeof(T); ++i)
+		{
+			value |= static_cast<T>(static_cast<T>(*in++) << (8 * i));
+		}
+		return value;
+	}
+}
+
+// Handler tables, indexed by Op, so entries must follow the order of the Op enum
+template <QuirkProfile P>
+constexpr std::array<Chip8::Chip8Func, OP_COUNT> Chip8::handlers = {
+	&Chip8::OP_NULL,
+	&Chip8::OP_00E0,
+	&Chip8::OP_00EE,
+	&Chip8::OP_1nnn,
+	&Chip8::OP_2nnn,
+	&Chip8::OP_3xkk<P>,
+	&Chip8::OP_4xkk<P>,
+	&Chip8::OP_5xy0<P>,
+	&Chip8::OP_6xkk,
+	&Chip8::OP_7xkk,
+	&Chip8::OP_8xy0,
+	&Chip8::OP_8xy1<P>,
+	&Chip8::OP_8xy2<P>,
+	&Chip8::OP_8xy3<P>,
+	&Chip8::OP_8xy4,
+	&Chip8::OP_8xy5,
+	&Chip8::OP_8xy6<P>,
+	&Chip8::OP_8xy7,
+	&Chip8::OP_8xyE<P>,
+	&Chip8::OP_9xy0<P>,
+	&Chip8::OP_Annn,
+	&Chip8::OP_Bnnn<P>,
+	&Chip8::OP_Cxkk,
+	&Chip8::OP_Dxyn<P>,
+	&Chip8::OP_Ex9E<P>,
+	&Chip8::OP_ExA1<P>,
+	&Chip8::OP_Fx07,
+	&Chip8::OP_Fx0A,
+	&Chip8::OP_Fx15,
+	&Chip8::OP_Fx18,
+	&Chip8::OP_Fx1E,
+	&Chip8::OP_Fx29,
+	&Chip8::OP_Fx33<P>,
+	&Chip8::OP_Fx55<P>,
+	&Chip8::OP_Fx65<P>,
+	&Chip8::OP_00Cn<P>,
+	&Chip8::OP_00Dn<P>,
+	&Chip8::OP_00FB<P>,
+	&Chip8::OP_00FC<P>,
+	&Chip8::OP_00FD<P>,
+	&Chip8::OP_00FE<P>,
+	&Chip8::OP_00FF<P>,
+	&Chip8::OP_5xy2<P>,
+	&Chip8::OP_5xy3<P>,
+	&Chip8::OP_F000<P>,
+	&Chip8::OP_Fn01<P>,
+	&Chip8::OP_F002<P>,
+	&Chip8::OP_Fx30<P>,
+	&Chip8::OP_Fx3A<P>,
+	&Chip8::OP_Fx75<P>,
+	&Chip8::OP_Fx85<P>,
+};
+
 /**
  * @brief Constructs a new Chip8 object and initializes its state.
  */
 Chip8::Chip8() 
-	: randGen(std::random_device{}())
+	: random(std::random_device{}())
 {
 	// Initialize PC
 	pc = START_ADDRESS;
 
 	// Load fonts into memory
 	std::copy(fontset.begin(), fontset.end(), memory.begin() + FONTSET_START_ADDRESS);
+	std::copy(bigFontset.begin(), bigFontset.end(), memory.begin() + BIGFONT_START_ADDRESS);
 
-	// Initialize RNG
-	randByte = std::uniform_int_distribution<uint8_t>(0, 255U);
-
-	// Set up function pointer table
-	table[0x0] = &Chip8::Table0;
-	table[0x1] = &Chip8::OP_1nnn;
-	table[0x2] = &Chip8::OP_2nnn;
-	table[0x3] = &Chip8::OP_3xkk;
-	table[0x4] = &Chip8::OP_4xkk;
-	table[0x5] = &Chip8::OP_5xy0;
-	table[0x6] = &Chip8::OP_6xkk;
-	table[0x7] = &Chip8::OP_7xkk;
-	table[0x8] = &Chip8::Table8;
-	table[0x9] = &Chip8::OP_9xy0;
-	table[0xA] = &Chip8::OP_Annn;
-	table[0xB] = &Chip8::OP_Bnnn;
-	table[0xC] = &Chip8::OP_Cxkk;
-	table[0xD] = &Chip8::OP_Dxyn;
-	table[0xE] = &Chip8::TableE;
-	table[0xF] = &Chip8::TableF;
-
-	table0.fill(&Chip8::OP_NULL);
-	table8.fill(&Chip8::OP_NULL);
-	tableE.fill(&Chip8::OP_NULL);
-
-	table0[0x0] = &Chip8::OP_00E0;
-	table0[0xE] = &Chip8::OP_00EE;
-
-	table8[0x0] = &Chip8::OP_8xy0;
-	table8[0x1] = &Chip8::OP_8xy1;
-	table8[0x2] = &Chip8::OP_8xy2;
-	table8[0x3] = &Chip8::OP_8xy3;
-	table8[0x4] = &Chip8::OP_8xy4;
-	table8[0x5] = &Chip8::OP_8xy5;
-	table8[0x6] = &Chip8::OP_8xy6;
-	table8[0x7] = &Chip8::OP_8xy7;
-	table8[0xE] = &Chip8::OP_8xyE;
-
-	tableE[0x1] = &Chip8::OP_ExA1;
-	tableE[0xE] = &Chip8::OP_Ex9E;
-
-	tableF.fill(&Chip8::OP_NULL);
-
-	tableF[0x07] = &Chip8::OP_Fx07;
-	tableF[0x0A] = &Chip8::OP_Fx0A;
-	tableF[0x15] = &Chip8::OP_Fx15;
-	tableF[0x18] = &Chip8::OP_Fx18;
-	tableF[0x1E] = &Chip8::OP_Fx1E;
-	tableF[0x29] = &Chip8::OP_Fx29;
-	tableF[0x33] = &Chip8::OP_Fx33;
-	tableF[0x55] = &Chip8::OP_Fx55;
-	tableF[0x65] = &Chip8::OP_Fx65;
+	SetQuirks(quirkProfile);
+	SetBackend(backend);
 }
 
+Chip8::~Chip8() = default;
+Chip8::Chip8(Chip8&&) noexcept = default;
+Chip8& Chip8::operator=(Chip8&&) noexcept = default;
+
 /**
  * @brief Loads a ROM file into the CHIP-8 memory.
  * 
  * @param filename The path to the ROM file.
+ * @return true if the ROM was read and fits in program memory.
  */
-void Chip8::LoadROM(const std::string& filename)
+bool Chip8::LoadROM(const std::string& filename)
 {
 	std::ifstream file(filename, std::ios::binary | std::ios::ate);
 
-	if (file.is_open())
-	{
-		std::streamsize size = file.tellg();
-		file.seekg(0, std::ios::beg);
-		std::vector<char> buffer(size);
-		if (file.read(buffer.data(), size))
-		{
-			std::copy(buffer.begin(), buffer.end(), memory.begin() + START_ADDRESS);
-		}
-	}
+	if (!file.is_open()) return false;
+
+	std::streamsize size = file.tellg();
+	if (size < 0 || size > static_cast<std::streamsize>(RomCapacity(quirkProfile))) return false;
+
+	file.seekg(0, std::ios::beg);
+	std::vector<char> buffer(size);
+	if (!file.read(buffer.data(), size)) return false;
+
+	return LoadROM(reinterpret_cast<uint8_t const*>(buffer.data()), buffer.size());
+}
+
+/**
+ * @brief Loads a ROM image from memory into the CHIP-8 memory.
+ * 
+ * Program memory ends with the 12-bit address space, except on XO-CHIP, whose programs may fill
+ * all 64 KB and reach the rest with F000 NNNN.
+ * 
+ * @param data The ROM bytes.
+ * @param size The number of bytes.
+ * @return true if the ROM fits in program memory.
+ */
+bool Chip8::LoadROM(uint8_t const* data, size_t size)
+{
+	if (size > RomCapacity(quirkProfile)) return false;
+
+	std::copy(data, data + size, Memory() + START_ADDRESS);
+	decodeCache.fill(Instruction{});
+	if (translator) translator->Invalidate(*this, START_ADDRESS, RomCapacity(quirkProfile));
+	return true;
 }
 
 /**
@@ -118,15 +317,279 @@ void Chip8::LoadROM(const std::string& filename)
  */
 void Chip8::Cycle()
 {
-	// Fetch
-	opcode = (memory[pc] << 8u) | memory[pc + 1];
+	// Fetch the decoded instruction
+	Instruction const& in = Fetch(pc);
+	profiler.Count(in.op, pc);
 
 	// Increment the PC before we execute anything
 	pc += 2;
 
-	// Decode and Execute
-	(this->*table[(opcode & 0xF000u) >> 12u])();
+	// Execute
+	Execute(in);
+}
+
+/**
+ * @brief Returns the decoded instruction at an address, decoding it on first use.
+ * 
+ * Instructions in program memory are decoded once and kept in the decode cache until
+ * something writes over them. Anything outside it is decoded into a scratch slot each time.
+ * 
+ * @param address The address of the instruction.
+ * @return The decoded instruction.
+ */
+Instruction const& Chip8::Fetch(uint16_t address)
+{
+	if (address >= START_ADDRESS && address < CODE_SPACE)
+	{
+		Instruction& in = decodeCache[address - START_ADDRESS];
+		if (!in.decoded) in = Decode(address);
+		return in;
+	}
+
+	uncached = Decode(address);
+	return uncached;
+}
+
+/**
+ * @brief Decodes the instruction at an address into its Op and operands.
+ * 
+ * @param address The address of the instruction.
+ * @return The decoded instruction.
+ */
+Instruction Chip8::Decode(uint16_t address) const
+{
+	uint8_t const* mem = Memory();
+	const unsigned int mask = MemorySizeOf(quirkProfile) - 1;
+
+	Instruction in;
+	in.opcode = (mem[address & mask] << 8u) | mem[(address + 1) & mask];
+	in.nnn = in.opcode & 0x0FFFu;
+	in.x = (in.opcode & 0x0F00u) >> 8u;
+	in.y = (in.opcode & 0x00F0u) >> 4u;
+	in.kk = in.opcode & 0x00FFu;
+	in.n = in.opcode & 0x000Fu;
+
+	in.op = OpFor(in.opcode);
+	in.decoded = true;
+	return in;
+}
+
+/**
+ * @brief Runs off a whole budget of cycles at once if pc sits in an idle loop.
+ * 
+ * Within one Run() the timers and the keypad are fixed, so two kinds of loop can never end early:
+ * a jump to itself, and a delay timer poll (Fx07; 3xkk or 4xkk on the same register; a jump back
+ * to the Fx07) whose skip does not fire for the current delay timer. Running any number of cycles
+ * through either leaves the machine as after the first pass, apart from where in the loop pc
+ * stops, so the result is computed instead of interpreted.
+ * 
+ * @param cycles The number of instructions left to execute.
+ * @return true if pc was in an idle loop and the cycles were consumed.
+ */
+bool Chip8::SkipIdleLoop(unsigned int cycles)
+{
+	if (pc < START_ADDRESS || pc + 6u > MemorySizeOf(quirkProfile)) return false;
+
+	Instruction const poll = Fetch(pc);
+	if (poll.op == Op::OP_1nnn)
+	{
+		if (poll.nnn != pc) return false;
+		skippedCycleCount += cycles;
+		return true;
+	}
+	if (poll.op != Op::OP_Fx07) return false;
+
+	Instruction const test = Fetch(pc + 2u);
+	Instruction const jump = Fetch(pc + 4u);
+	if (jump.op != Op::OP_1nnn || jump.nnn != pc || test.x != poll.x) return false;
+	if (test.op == Op::OP_3xkk ? delayTimer == test.kk : test.op != Op::OP_4xkk || delayTimer != test.kk) return false;
+
+	// Each pass of three instructions reloads Vx from the unchanged delay timer
+	if (cycles > 0) registers[poll.x] = delayTimer;
+	pc = static_cast<uint16_t>(pc + 2u * (cycles % 3u));
+	skippedCycleCount += cycles;
+	return true;
+}
 
+/**
+ * @brief Returns the name of a quirk profile as given on command lines.
+ * 
+ * @param profile The profile.
+ * @return "modern", "vip", "schip" or "xochip".
+ */
+char const* QuirkProfileName(QuirkProfile profile)
+{
+	switch (profile)
+	{
+		case QuirkProfile::CosmacVip: return "vip";
+		case QuirkProfile::SuperChip: return "schip";
+		case QuirkProfile::XoChip:    return "xochip";
+		default:                      return "modern";
+	}
+}
+
+/**
+ * @brief Parses a quirk profile name.
+ * 
+ * @param name The name, as returned by QuirkProfileName().
+ * @param profile Receives the profile if the name is valid.
+ * @return true if the name is valid.
+ */
+bool ParseQuirkProfile(std::string const& name, QuirkProfile& profile)
+{
+	for (QuirkProfile candidate : {QuirkProfile::Modern, QuirkProfile::CosmacVip, QuirkProfile::SuperChip, QuirkProfile::XoChip})
+	{
+		if (name == QuirkProfileName(candidate))
+		{
+			profile = candidate;
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * @brief Hashes a framebuffer (64-bit FNV-1a over its rows).
+ * 
+ * The second plane and the resolution only go into the hash once a frame uses them, so a 64x32
+ * single-plane frame hashes as it did before SUPER-CHIP and XO-CHIP support, and manifests stay valid.
+ * 
+ * @param video The framebuffer.
+ * @return The hash.
+ */
+uint64_t HashVideo(VideoBuffer const& video)
+{
+	uint64_t hash = 14695981039346656037ull;
+	auto mix = [&hash](uint64_t word) {
+		for (unsigned int i = 0; i < 8; ++i)
+		{
+			hash = (hash ^ ((word >> (8 * i)) & 0xFF)) * 1099511628211ull;
+		}
+	};
+
+	const unsigned int words = video.Height() * video.RowWords();
+	for (unsigned int w = 0; w < words; ++w) mix(video.planes[0][w]);
+
+	bool secondPlane = std::any_of(video.planes[1].begin(), video.planes[1].begin() + words, [](uint64_t word) { return word != 0; });
+	if (video.hires || secondPlane)
+	{
+		mix(video.hires ? 1 : 0);
+		for (unsigned int w = 0; w < words; ++w) mix(video.planes[1][w]);
+	}
+	return hash;
+}
+
+/**
+ * @brief Decodes an opcode into the Op the interpreter executes it as.
+ * 
+ * Every opcode in a group's unused encodings (0nn0, ExnE, ...) decodes like the interpreter runs it,
+ * so other engines can follow the same table.
+ * 
+ * @param opcode The opcode.
+ * @return The Op, or OP_NULL for opcodes the interpreter ignores.
+ */
+Op Decode(uint16_t opcode) { return OpFor(opcode); }
+
+/**
+ * @brief Disassembles an opcode into the mnemonic it executes as.
+ * 
+ * Mnemonics follow Cowgod's reference. Opcodes the interpreter ignores come out as DW with the raw word.
+ * 
+ * @param opcode The opcode.
+ * @return The instruction text, e.g. "LD VA, 0x3C".
+ */
+std::string Disassemble(uint16_t opcode)
+{
+	unsigned int nnn = opcode & 0x0FFFu;
+	unsigned int x = (opcode & 0x0F00u) >> 8u;
+	unsigned int y = (opcode & 0x00F0u) >> 4u;
+	unsigned int kk = opcode & 0x00FFu;
+	unsigned int n = opcode & 0x000Fu;
+
+	char text[24];
+	switch (OpFor(opcode))
+	{
+		case Op::OP_00E0: return "CLS";
+		case Op::OP_00EE: return "RET";
+		case Op::OP_1nnn: std::snprintf(text, sizeof(text), "JP 0x%03X", nnn); break;
+		case Op::OP_2nnn: std::snprintf(text, sizeof(text), "CALL 0x%03X", nnn); break;
+		case Op::OP_3xkk: std::snprintf(text, sizeof(text), "SE V%X, 0x%02X", x, kk); break;
+		case Op::OP_4xkk: std::snprintf(text, sizeof(text), "SNE V%X, 0x%02X", x, kk); break;
+		case Op::OP_5xy0: std::snprintf(text, sizeof(text), "SE V%X, V%X", x, y); break;
+		case Op::OP_6xkk: std::snprintf(text, sizeof(text), "LD V%X, 0x%02X", x, kk); break;
+		case Op::OP_7xkk: std::snprintf(text, sizeof(text), "ADD V%X, 0x%02X", x, kk); break;
+		case Op::OP_8xy0: std::snprintf(text, sizeof(text), "LD V%X, V%X", x, y); break;
+		case Op::OP_8xy1: std::snprintf(text, sizeof(text), "OR V%X, V%X", x, y); break;
+		case Op::OP_8xy2: std::snprintf(text, sizeof(text), "AND V%X, V%X", x, y); break;
+		case Op::OP_8xy3: std::snprintf(text, sizeof(text), "XOR V%X, V%X", x, y); break;
+		case Op::OP_8xy4: std::snprintf(text, sizeof(text), "ADD V%X, V%X", x, y); break;
+		case Op::OP_8xy5: std::snprintf(text, sizeof(text), "SUB V%X, V%X", x, y); break;
+		case Op::OP_8xy6: std::snprintf(text, sizeof(text), "SHR V%X", x); break;
+		case Op::OP_8xy7: std::snprintf(text, sizeof(text), "SUBN V%X, V%X", x, y); break;
+		case Op::OP_8xyE: std::snprintf(text, sizeof(text), "SHL V%X", x); break;
+		case Op::OP_9xy0: std::snprintf(text, sizeof(text), "SNE V%X, V%X", x, y); break;
+		case Op::OP_Annn: std::snprintf(text, sizeof(text), "LD I, 0x%03X", nnn); break;
+		case Op::OP_Bnnn: std::snprintf(text, sizeof(text), "JP V0, 0x%03X", nnn); break;
+		case Op::OP_Cxkk: std::snprintf(text, sizeof(text), "RND V%X, 0x%02X", x, kk); break;
+		case Op::OP_Dxyn: std::snprintf(text, sizeof(text), "DRW V%X, V%X, %u", x, y, n); break;
+		case Op::OP_Ex9E: std::snprintf(text, sizeof(text), "SKP V%X", x); break;
+		case Op::OP_ExA1: std::snprintf(text, sizeof(text), "SKNP V%X", x); break;
+		case Op::OP_Fx07: std::snprintf(text, sizeof(text), "LD V%X, DT", x); break;
+		case Op::OP_Fx0A: std::snprintf(text, sizeof(text), "LD V%X, K", x); break;
+		case Op::OP_Fx15: std::snprintf(text, sizeof(text), "LD DT, V%X", x); break;
+		case Op::OP_Fx18: std::snprintf(text, sizeof(text), "LD ST, V%X", x); break;
+		case Op::OP_Fx1E: std::snprintf(text, sizeof(text), "ADD I, V%X", x); break;
+		case Op::OP_Fx29: std::snprintf(text, sizeof(text), "LD F, V%X", x); break;
+		case Op::OP_Fx33: std::snprintf(text, sizeof(text), "LD B, V%X", x); break;
+		case Op::OP_Fx55: std::snprintf(text, sizeof(text), "LD [I], V%X", x); break;
+		case Op::OP_Fx65: std::snprintf(text, sizeof(text), "LD V%X, [I]", x); break;
+		case Op::OP_00Cn: std::snprintf(text, sizeof(text), "SCD %u", n); break;
+		case Op::OP_00Dn: std::snprintf(text, sizeof(text), "SCU %u", n); break;
+		case Op::OP_00FB: return "SCR";
+		case Op::OP_00FC: return "SCL";
+		case Op::OP_00FD: return "EXIT";
+		case Op::OP_00FE: return "LOW";
+		case Op::OP_00FF: return "HIGH";
+		case Op::OP_5xy2: std::snprintf(text, sizeof(text), "SAVE V%X - V%X", x, y); break;
+		case Op::OP_5xy3: std::snprintf(text, sizeof(text), "LOAD V%X - V%X", x, y); break;
+		case Op::OP_F000: return "LD I, LONG";
+		case Op::OP_Fn01: std::snprintf(text, sizeof(text), "PLANE %u", x); break;
+		case Op::OP_F002: return "AUDIO";
+		case Op::OP_Fx30: std::snprintf(text, sizeof(text), "LD HF, V%X", x); break;
+		case Op::OP_Fx3A: std::snprintf(text, sizeof(text), "PITCH V%X", x); break;
+		case Op::OP_Fx75: std::snprintf(text, sizeof(text), "LD R, V%X", x); break;
+		case Op::OP_Fx85: std::snprintf(text, sizeof(text), "LD V%X, R", x); break;
+		default:          std::snprintf(text, sizeof(text), "DW 0x%04X", opcode); break;
+	}
+	return text;
+}
+
+/**
+ * @brief Drops decoded instructions that overlap a range of memory that was just written.
+ * 
+ * An instruction starting one byte before the range also overlaps it, since instructions are two bytes long.
+ * 
+ * @param address The first address written.
+ * @param length The number of bytes written.
+ */
+void Chip8::InvalidateCode(unsigned int address, unsigned int length)
+{
+	unsigned int first = std::max(address, START_ADDRESS + 1) - 1;
+	unsigned int last = std::min(address + length, CODE_SPACE);
+
+	for (unsigned int a = first; a < last; ++a)
+	{
+		decodeCache[a - START_ADDRESS].decoded = false;
+	}
+
+	if (translator) translator->Invalidate(*this, address, length);
+}
+
+/**
+ * @brief Decrements the delay and sound timers. Called once per 60 Hz frame.
+ */
+void Chip8::TickTimers()
+{
 	// Decrement the delay timer if it's been set
 	if (delayTimer > 0) --delayTimer;
 
@@ -135,102 +598,671 @@ void Chip8::Cycle()
 }
 
 /**
- * @brief Handles opcodes starting with 0x0.
+ * @brief Executes one 60 Hz frame: a fixed number of CPU cycles followed by one timer tick.
+ * 
+ * @param instructionsPerFrame The number of instructions to execute in the frame.
+ */
+void Chip8::RunFrame(unsigned int instructionsPerFrame)
+{
+	Run(instructionsPerFrame);
+	TickTimers();
+	profiler.Frame();
+}
+
+/**
+ * @brief Executes a number of CPU cycles with the selected backend.
+ * 
+ * A machine halted in Fx0A stays halted without executing anything until a key is down, and
+ * every backend stops early when Fx0A halts it; re-running Fx0A against the same keypad would
+ * change nothing, so this is exact. Idle loops are skipped the same way (see SkipIdleLoop()),
+ * here and after every short backward jump. InstructionCount() only counts the instructions
+ * actually executed, and SkippedCycleCount() the cycles skipping ran off.
+ * 
+ * @param cycles The number of instructions to execute.
+ */
+void Chip8::Run(unsigned int cycles)
+{
+	if (waitingForKey)
+	{
+		if (std::none_of(keypad.begin(), keypad.end(), [](uint8_t key) { return key != 0; })) return;
+		waitingForKey = false;
+	}
+
+	unsigned int left;
+
+	// A debugger must see every instruction, so nothing is skipped or translated while one is attached
+	if (debugger && debugger->Attached()) left = RunDebugged(cycles);
+	else if (SkipIdleLoop(cycles)) left = cycles;
+	else if (trace) left = RunTraced(cycles);
+	else
+	{
+		switch (quirkProfile)
+		{
+			case QuirkProfile::CosmacVip: left = RunBackend<QuirkProfile::CosmacVip>(cycles); break;
+			case QuirkProfile::SuperChip: left = RunBackend<QuirkProfile::SuperChip>(cycles); break;
+			case QuirkProfile::XoChip:    left = RunBackend<QuirkProfile::XoChip>(cycles); break;
+			default:                      left = RunBackend<QuirkProfile::Modern>(cycles); break;
+		}
+	}
+
+	instructionCount += cycles - left;
+}
+
+/**
+ * @brief Runs the selected backend, specialized for a quirk profile.
+ * 
+ * @param cycles The number of instructions to execute.
+ * @return The cycles not executed: those an idle-loop skip ran off, or the rest once Fx0A halts.
+ */
+template <QuirkProfile P>
+unsigned int Chip8::RunBackend(unsigned int cycles)
+{
+	switch (backend)
+	{
+		case Backend::Switch:   return RunSwitch<P>(cycles);
+		case Backend::Threaded: return RunThreaded<P>(cycles);
+		case Backend::Jit:
+		case Backend::Static:
+			// Translated code cannot be counted instruction by instruction, so profiled builds interpret it
+			if (!Profiler::ENABLED && translator && translator->Kind() == backend) return translator->Run(*this, cycles);
+			return RunThreaded<P>(cycles);
+		default:                return RunTable<P>(cycles);
+	}
+}
+
+/**
+ * @brief Selects the interpreter backend used by Run() and RunFrame().
+ * 
+ * Selecting Jit creates the block translator on hosts that support it. Whenever the selected backend has
+ * no translator (Jit on other hosts, Static without a program), Run() interprets with the threaded backend.
+ * 
+ * @param newBackend The backend to use from now on.
+ */
+void Chip8::SetBackend(Backend newBackend)
+{
+	backend = newBackend;
+
+	if (backend == Backend::Jit && !(translator && translator->Kind() == Backend::Jit) && Jit::Supported())
+	{
+		translator = std::make_unique<Jit>();
+	}
+}
+
+/**
+ * @brief Selects the CHIP-8 variant the machine behaves as.
+ * 
+ * Handlers called through Execute() switch to the profile's table; the backend loops pick their
+ * specialization on every Run(). Translated code bakes the quirks in, so all of it is dropped.
+ * 
+ * Only XO-CHIP has more than 4 KB of memory. Its 64 KB are allocated when it is selected, starting
+ * with the contents of the built-in memory, and the first 4 KB are copied back when it is left.
+ * 
+ * @param profile The profile to use from now on.
+ */
+void Chip8::SetQuirks(QuirkProfile profile)
+{
+	quirkProfile = profile;
+
+	if (QuirksOf(profile).xoChip && !extendedMemory)
+	{
+		extendedMemory = std::make_unique<std::array<uint8_t, XO_MEMORY_SIZE>>();
+		std::copy(memory.begin(), memory.end(), extendedMemory->begin());
+	}
+	else if (!QuirksOf(profile).xoChip && extendedMemory)
+	{
+		std::copy_n(extendedMemory->begin(), MEMORY_SIZE, memory.begin());
+		extendedMemory.reset();
+	}
+	profiler.SetMemorySize(MemorySizeOf(profile));
+
+	switch (profile)
+	{
+		case QuirkProfile::CosmacVip: handlerTable = &handlers<QuirkProfile::CosmacVip>; break;
+		case QuirkProfile::SuperChip: handlerTable = &handlers<QuirkProfile::SuperChip>; break;
+		case QuirkProfile::XoChip:    handlerTable = &handlers<QuirkProfile::XoChip>; break;
+		default:                      handlerTable = &handlers<QuirkProfile::Modern>; break;
+	}
+
+	if (translator) translator->Invalidate(*this, 0, MemorySizeOf(profile));
+}
+
+/**
+ * @brief Runs a ROM recompiled ahead of time by chip8-recompile, selecting the Static backend.
+ * 
+ * @param program The recompiled program, which must outlive this machine.
+ */
+void Chip8::SetStaticProgram(StaticProgram const& program)
+{
+	translator = std::make_unique<StaticRunner>(program, *this);
+	backend = Backend::Static;
+}
+
+/**
+ * @brief Writes the machine state into a buffer in the save-state format.
+ * 
+ * @param data The buffer, at least SaveStateSize() bytes.
+ * @param size The size of the buffer.
+ * @return true if the buffer was large enough.
+ */
+bool Chip8::SaveState(uint8_t* data, size_t size) const
+{
+	if (size < SaveStateSize()) return false;
+
+	const unsigned int memorySize = MemorySizeOf(quirkProfile);
+	uint8_t* out = std::copy(SAVE_STATE_MAGIC.begin(), SAVE_STATE_MAGIC.end(), data);
+	out = Put<uint32_t>(out, SAVE_STATE_VERSION);
+	out = Put<uint32_t>(out, memorySize);
+	out = Put<uint32_t>(out, random.State());
+	out = Put<uint16_t>(out, pc);
+	out = Put<uint16_t>(out, index);
+	out = Put<uint8_t>(out, sp);
+	out = Put<uint8_t>(out, delayTimer);
+	out = Put<uint8_t>(out, soundTimer);
+	out = std::copy(registers.begin(), registers.end(), out);
+	for (uint16_t entry : stack) out = Put<uint16_t>(out, entry);
+	out = Put<uint8_t>(out, video.hires ? 1 : 0);
+	out = Put<uint8_t>(out, planeMask);
+	out = Put<uint8_t>(out, pitch);
+	out = std::copy(flagRegisters.begin(), flagRegisters.end(), out);
+	out = std::copy(audioPattern.begin(), audioPattern.end(), out);
+	for (VideoBuffer::Plane const& plane : video.planes)
+	{
+		for (uint64_t word : plane) out = Put<uint64_t>(out, word);
+	}
+	std::copy_n(Memory(), memorySize, out);
+
+	return true;
+}
+
+/**
+ * @brief Restores a state written by SaveState().
+ * 
+ * The header and the fields that could leave the machine unusable are checked before anything
+ * changes; that includes the memory size, so a state only loads into a machine whose profile
+ * has as much memory as the one that saved it. Decoded and translated code is only dropped for
+ * the span of memory that differs.
+ * 
+ * @param data The save state.
+ * @param size The number of bytes available.
+ * @return true if the state was valid and restored.
+ */
+bool Chip8::LoadState(uint8_t const* data, size_t size)
+{
+	const unsigned int memorySize = MemorySizeOf(quirkProfile);
+	if (size < SaveStateSize() || !std::equal(SAVE_STATE_MAGIC.begin(), SAVE_STATE_MAGIC.end(), data)) return false;
+
+	uint8_t const* in = data + SAVE_STATE_MAGIC.size();
+	if (Get<uint32_t>(in) != SAVE_STATE_VERSION) return false;
+	if (Get<uint32_t>(in) != memorySize) return false;
+
+	uint32_t randomState = Get<uint32_t>(in);
+	uint16_t newPc = Get<uint16_t>(in);
+	uint16_t newIndex = Get<uint16_t>(in);
+	uint8_t newSp = Get<uint8_t>(in);
+	if (randomState == 0) return false;
+
+	random.SetState(randomState);
+	pc = newPc;
+	index = newIndex;
+	sp = newSp;
+	delayTimer = Get<uint8_t>(in);
+	soundTimer = Get<uint8_t>(in);
+	std::copy(in, in + REGISTER_COUNT, registers.begin());
+	in += REGISTER_COUNT;
+	for (uint16_t& entry : stack) entry = Get<uint16_t>(in);
+	video.hires = Get<uint8_t>(in) != 0;
+	planeMask = Get<uint8_t>(in) & ((1u << VIDEO_PLANES) - 1);
+	pitch = Get<uint8_t>(in);
+	std::copy(in, in + FLAG_REGISTER_COUNT, flagRegisters.begin());
+	in += FLAG_REGISTER_COUNT;
+	std::copy(in, in + AUDIO_PATTERN_SIZE, audioPattern.begin());
+	in += AUDIO_PATTERN_SIZE;
+	for (VideoBuffer::Plane& plane : video.planes)
+	{
+		for (uint64_t& word : plane) word = Get<uint64_t>(in);
+	}
+	MarkVideoChanged();
+	waitingForKey = false;
+
+	// Find the span of memory the state changes, so code outside it stays decoded
+	uint8_t* mem = Memory();
+	auto first = std::mismatch(mem, mem + memorySize, in);
+	if (first.first == mem + memorySize) return true;
+
+	auto last = std::mismatch(std::reverse_iterator<uint8_t*>(mem + memorySize), std::reverse_iterator<uint8_t*>(mem),
+		std::reverse_iterator<uint8_t const*>(in + memorySize));
+	unsigned int begin = static_cast<unsigned int>(first.first - mem);
+	unsigned int end = static_cast<unsigned int>(last.first.base() - mem);
+
+	std::copy(first.second, in + end, first.first);
+	InvalidateCode(begin, end - begin);
+
+	return true;
+}
+
+/**
+ * @brief Table backend: calls each instruction's handler through the shared pointer-to-member table.
+ * 
+ * @param cycles The number of instructions to execute.
+ * @return The cycles left once Fx0A halts, or 0.
  */
-void Chip8::Table0() { (this->*table0[opcode & 0x000Fu])(); }
+template <QuirkProfile P>
+unsigned int Chip8::RunTable(unsigned int cycles)
+{
+	for (; cycles > 0 && !waitingForKey; --cycles)
+	{
+		Instruction const& in = Fetch(pc);
+		profiler.Count(in.op, pc);
+		pc += 2;
+		(this->*handlers<P>[static_cast<size_t>(in.op)])(in);
+	}
+
+	return cycles;
+}
 
 /**
- * @brief Handles opcodes starting with 0x8.
+ * @brief Switch backend: dispatches on the decoded Op, letting the compiler inline every handler.
+ * 
+ * @param cycles The number of instructions to execute.
+ * @return The cycles not executed: those an idle-loop skip ran off, or the rest once Fx0A halts.
  */
-void Chip8::Table8() { (this->*table8[opcode & 0x000Fu])(); }
+template <QuirkProfile P>
+unsigned int Chip8::RunSwitch(unsigned int cycles)
+{
+	for (; cycles > 0; --cycles)
+	{
+		Instruction const& in = Fetch(pc);
+		profiler.Count(in.op, pc);
+		pc += 2;
+
+		switch (in.op)
+		{
+			case Op::OP_NULL: OP_NULL(in); break;
+			case Op::OP_00E0: OP_00E0(in); break;
+			case Op::OP_00EE: OP_00EE(in); break;
+			case Op::OP_1nnn:
+				if (ShortBackJump(in))
+				{
+					OP_1nnn(in);
+					if (SkipIdleLoop(cycles - 1)) return cycles - 1;
+					break;
+				}
+				OP_1nnn(in);
+				break;
+			case Op::OP_2nnn: OP_2nnn(in); break;
+			case Op::OP_3xkk: OP_3xkk<P>(in); break;
+			case Op::OP_4xkk: OP_4xkk<P>(in); break;
+			case Op::OP_5xy0: OP_5xy0<P>(in); break;
+			case Op::OP_6xkk: OP_6xkk(in); break;
+			case Op::OP_7xkk: OP_7xkk(in); break;
+			case Op::OP_8xy0: OP_8xy0(in); break;
+			case Op::OP_8xy1: OP_8xy1<P>(in); break;
+			case Op::OP_8xy2: OP_8xy2<P>(in); break;
+			case Op::OP_8xy3: OP_8xy3<P>(in); break;
+			case Op::OP_8xy4: OP_8xy4(in); break;
+			case Op::OP_8xy5: OP_8xy5(in); break;
+			case Op::OP_8xy6: OP_8xy6<P>(in); break;
+			case Op::OP_8xy7: OP_8xy7(in); break;
+			case Op::OP_8xyE: OP_8xyE<P>(in); break;
+			case Op::OP_9xy0: OP_9xy0<P>(in); break;
+			case Op::OP_Annn: OP_Annn(in); break;
+			case Op::OP_Bnnn: OP_Bnnn<P>(in); break;
+			case Op::OP_Cxkk: OP_Cxkk(in); break;
+			case Op::OP_Dxyn: OP_Dxyn<P>(in); break;
+			case Op::OP_Ex9E: OP_Ex9E<P>(in); break;
+			case Op::OP_ExA1: OP_ExA1<P>(in); break;
+			case Op::OP_Fx07: OP_Fx07(in); break;
+			case Op::OP_Fx0A: OP_Fx0A(in); if (waitingForKey) return cycles - 1; break;
+			case Op::OP_Fx15: OP_Fx15(in); break;
+			case Op::OP_Fx18: OP_Fx18(in); break;
+			case Op::OP_Fx1E: OP_Fx1E(in); break;
+			case Op::OP_Fx29: OP_Fx29(in); break;
+			case Op::OP_Fx33: OP_Fx33<P>(in); break;
+			case Op::OP_Fx55: OP_Fx55<P>(in); break;
+			case Op::OP_Fx65: OP_Fx65<P>(in); break;
+			case Op::OP_00Cn: OP_00Cn<P>(in); break;
+			case Op::OP_00Dn: OP_00Dn<P>(in); break;
+			case Op::OP_00FB: OP_00FB<P>(in); break;
+			case Op::OP_00FC: OP_00FC<P>(in); break;
+			case Op::OP_00FD: OP_00FD<P>(in); break;
+			case Op::OP_00FE: OP_00FE<P>(in); break;
+			case Op::OP_00FF: OP_00FF<P>(in); break;
+			case Op::OP_5xy2: OP_5xy2<P>(in); break;
+			case Op::OP_5xy3: OP_5xy3<P>(in); break;
+			case Op::OP_F000: OP_F000<P>(in); break;
+			case Op::OP_Fn01: OP_Fn01<P>(in); break;
+			case Op::OP_F002: OP_F002<P>(in); break;
+			case Op::OP_Fx30: OP_Fx30<P>(in); break;
+			case Op::OP_Fx3A: OP_Fx3A<P>(in); break;
+			case Op::OP_Fx75: OP_Fx75<P>(in); break;
+			case Op::OP_Fx85: OP_Fx85<P>(in); break;
+		}
+	}
+
+	return 0;
+}
 
 /**
- * @brief Handles opcodes starting with 0xE.
+ * @brief Threaded backend: computed-goto dispatch, where every handler ends with its own indirect jump
+ * to the next one instead of returning to a shared loop.
+ * 
+ * Needs the GCC/Clang labels-as-values extension; other compilers fall back to the switch backend.
+ * 
+ * @param cycles The number of instructions to execute.
+ * @return The cycles not executed: those an idle-loop skip ran off, or the rest once Fx0A halts.
  */
-void Chip8::TableE() { (this->*tableE[opcode & 0x000Fu])(); }
+template <QuirkProfile P>
+unsigned int Chip8::RunThreaded(unsigned int cycles)
+{
+#if defined(__GNUC__)
+	// Indexed by Op, so the order must match the enum
+	static void* const labels[OP_COUNT] = {
+		&&L_OP_NULL,
+		&&L_OP_00E0,
+		&&L_OP_00EE,
+		&&L_OP_1nnn,
+		&&L_OP_2nnn,
+		&&L_OP_3xkk,
+		&&L_OP_4xkk,
+		&&L_OP_5xy0,
+		&&L_OP_6xkk,
+		&&L_OP_7xkk,
+		&&L_OP_8xy0,
+		&&L_OP_8xy1,
+		&&L_OP_8xy2,
+		&&L_OP_8xy3,
+		&&L_OP_8xy4,
+		&&L_OP_8xy5,
+		&&L_OP_8xy6,
+		&&L_OP_8xy7,
+		&&L_OP_8xyE,
+		&&L_OP_9xy0,
+		&&L_OP_Annn,
+		&&L_OP_Bnnn,
+		&&L_OP_Cxkk,
+		&&L_OP_Dxyn,
+		&&L_OP_Ex9E,
+		&&L_OP_ExA1,
+		&&L_OP_Fx07,
+		&&L_OP_Fx0A,
+		&&L_OP_Fx15,
+		&&L_OP_Fx18,
+		&&L_OP_Fx1E,
+		&&L_OP_Fx29,
+		&&L_OP_Fx33,
+		&&L_OP_Fx55,
+		&&L_OP_Fx65,
+		&&L_OP_00Cn,
+		&&L_OP_00Dn,
+		&&L_OP_00FB,
+		&&L_OP_00FC,
+		&&L_OP_00FD,
+		&&L_OP_00FE,
+		&&L_OP_00FF,
+		&&L_OP_5xy2,
+		&&L_OP_5xy3,
+		&&L_OP_F000,
+		&&L_OP_Fn01,
+		&&L_OP_F002,
+		&&L_OP_Fx30,
+		&&L_OP_Fx3A,
+		&&L_OP_Fx75,
+		&&L_OP_Fx85
+	};
+
+	Instruction const* in;
+
+#define DISPATCH()                                       \
+	do                                                   \
+	{                                                    \
+		if (cycles-- == 0) return 0;                     \
+		in = &Fetch(pc);                                 \
+		profiler.Count(in->op, pc);                      \
+		pc += 2;                                         \
+		goto *labels[static_cast<size_t>(in->op)];       \
+	} while (0)
+
+	DISPATCH();
+
+	L_OP_NULL: OP_NULL(*in); DISPATCH();
+	L_OP_00E0: OP_00E0(*in); DISPATCH();
+	L_OP_00EE: OP_00EE(*in); DISPATCH();
+	L_OP_1nnn:
+		if (ShortBackJump(*in))
+		{
+			OP_1nnn(*in);
+			if (SkipIdleLoop(cycles)) return cycles;
+			DISPATCH();
+		}
+		OP_1nnn(*in);
+		DISPATCH();
+	L_OP_2nnn: OP_2nnn(*in); DISPATCH();
+	L_OP_3xkk: OP_3xkk<P>(*in); DISPATCH();
+	L_OP_4xkk: OP_4xkk<P>(*in); DISPATCH();
+	L_OP_5xy0: OP_5xy0<P>(*in); DISPATCH();
+	L_OP_6xkk: OP_6xkk(*in); DISPATCH();
+	L_OP_7xkk: OP_7xkk(*in); DISPATCH();
+	L_OP_8xy0: OP_8xy0(*in); DISPATCH();
+	L_OP_8xy1: OP_8xy1<P>(*in); DISPATCH();
+	L_OP_8xy2: OP_8xy2<P>(*in); DISPATCH();
+	L_OP_8xy3: OP_8xy3<P>(*in); DISPATCH();
+	L_OP_8xy4: OP_8xy4(*in); DISPATCH();
+	L_OP_8xy5: OP_8xy5(*in); DISPATCH();
+	L_OP_8xy6: OP_8xy6<P>(*in); DISPATCH();
+	L_OP_8xy7: OP_8xy7(*in); DISPATCH();
+	L_OP_8xyE: OP_8xyE<P>(*in); DISPATCH();
+	L_OP_9xy0: OP_9xy0<P>(*in); DISPATCH();
+	L_OP_Annn: OP_Annn(*in); DISPATCH();
+	L_OP_Bnnn: OP_Bnnn<P>(*in); DISPATCH();
+	L_OP_Cxkk: OP_Cxkk(*in); DISPATCH();
+	L_OP_Dxyn: OP_Dxyn<P>(*in); DISPATCH();
+	L_OP_Ex9E: OP_Ex9E<P>(*in); DISPATCH();
+	L_OP_ExA1: OP_ExA1<P>(*in); DISPATCH();
+	L_OP_Fx07: OP_Fx07(*in); DISPATCH();
+	L_OP_Fx0A: OP_Fx0A(*in); if (waitingForKey) return cycles; DISPATCH();
+	L_OP_Fx15: OP_Fx15(*in); DISPATCH();
+	L_OP_Fx18: OP_Fx18(*in); DISPATCH();
+	L_OP_Fx1E: OP_Fx1E(*in); DISPATCH();
+	L_OP_Fx29: OP_Fx29(*in); DISPATCH();
+	L_OP_Fx33: OP_Fx33<P>(*in); DISPATCH();
+	L_OP_Fx55: OP_Fx55<P>(*in); DISPATCH();
+	L_OP_Fx65: OP_Fx65<P>(*in); DISPATCH();
+	L_OP_00Cn: OP_00Cn<P>(*in); DISPATCH();
+	L_OP_00Dn: OP_00Dn<P>(*in); DISPATCH();
+	L_OP_00FB: OP_00FB<P>(*in); DISPATCH();
+	L_OP_00FC: OP_00FC<P>(*in); DISPATCH();
+	L_OP_00FD: OP_00FD<P>(*in); DISPATCH();
+	L_OP_00FE: OP_00FE<P>(*in); DISPATCH();
+	L_OP_00FF: OP_00FF<P>(*in); DISPATCH();
+	L_OP_5xy2: OP_5xy2<P>(*in); DISPATCH();
+	L_OP_5xy3: OP_5xy3<P>(*in); DISPATCH();
+	L_OP_F000: OP_F000<P>(*in); DISPATCH();
+	L_OP_Fn01: OP_Fn01<P>(*in); DISPATCH();
+	L_OP_F002: OP_F002<P>(*in); DISPATCH();
+	L_OP_Fx30: OP_Fx30<P>(*in); DISPATCH();
+	L_OP_Fx3A: OP_Fx3A<P>(*in); DISPATCH();
+	L_OP_Fx75: OP_Fx75<P>(*in); DISPATCH();
+	L_OP_Fx85: OP_Fx85<P>(*in); DISPATCH();
+
+#undef DISPATCH
+#else
+	return RunSwitch<P>(cycles);
+#endif
+}
 
 /**
- * @brief Handles opcodes starting with 0xF.
+ * @brief Traced backend: executes like the table backend, recording each instruction into the trace ring.
+ * 
+ * Records carry pc, the opcode, I afterwards and the registers the instruction changed. Idle loops
+ * are skipped after short backward jumps exactly as in the switch backend, so a trace stays short
+ * while the machine waits.
+ * 
+ * @param cycles The number of instructions to execute.
+ * @return The cycles not executed: those an idle-loop skip ran off, or the rest once Fx0A halts.
  */
-void Chip8::TableF() { (this->*tableF[opcode & 0x00FFu])(); }
+unsigned int Chip8::RunTraced(unsigned int cycles)
+{
+	for (; cycles > 0 && !waitingForKey; --cycles)
+	{
+		uint16_t address = pc;
+		Instruction const& in = Fetch(pc);
+		uint16_t opcode = in.opcode;
+		profiler.Count(in.op, pc);
+		pc += 2;
+
+		bool backJump = in.op == Op::OP_1nnn && ShortBackJump(in);
+		std::array<uint8_t, REGISTER_COUNT> before = registers;
+		Execute(in);
+		trace->Record(address, opcode, index, before, registers);
+
+		if (backJump && SkipIdleLoop(cycles - 1))
+		{
+			--cycles;
+			break;
+		}
+	}
+
+	trace->Publish();
+	return cycles;
+}
+
+/**
+ * @brief Debugged backend: executes like the table backend, giving the attached debugger a chance to stop
+ * the machine before every instruction and after every Fx33, Fx55 and XO-CHIP 5xy2.
+ * 
+ * Stopping blocks right here until the debugger resumes the machine. Idle loops run instruction by
+ * instruction, so breakpoints inside them are hit; a trace, if one is attached too, is recorded as usual.
+ * 
+ * @param cycles The number of instructions to execute.
+ * @return The cycles left once Fx0A halts, or 0.
+ */
+unsigned int Chip8::RunDebugged(unsigned int cycles)
+{
+	for (bool frameStart = true; cycles > 0 && !waitingForKey; --cycles, frameStart = false)
+	{
+		debugger->BeforeInstruction(*this, frameStart);
+
+		uint16_t address = pc;
+		uint16_t written = index;
+		Instruction const& in = Fetch(pc);
+		profiler.Count(in.op, pc);
+		pc += 2;
+
+		std::array<uint8_t, REGISTER_COUNT> before = registers;
+		Execute(in);
+		if (trace) trace->Record(address, in.opcode, index, before, registers);
+
+		if (in.op == Op::OP_Fx33) debugger->AfterWrite(*this, written, 3);
+		else if (in.op == Op::OP_Fx55) debugger->AfterWrite(*this, written, in.x + 1u);
+		else if (in.op == Op::OP_5xy2 && QuirksOf(quirkProfile).xoChip) debugger->AfterWrite(*this, written, (in.x > in.y ? in.x - in.y : in.y - in.x) + 1u);
+	}
+
+	if (trace) trace->Publish();
+	return cycles;
+}
 
 /**
  * @brief No operation (NOP).
  */
-void Chip8::OP_NULL() {}
+void Chip8::OP_NULL(Instruction const&) {}
 
 /**
- * @brief Clears the display.
+ * @brief Clears the display: the planes selected with Fn01, which is only ever the first outside XO-CHIP.
  */
-void Chip8::OP_00E0() { video.fill(0); }
+void Chip8::OP_00E0(Instruction const&)
+{
+	for (unsigned int p = 0; p < VIDEO_PLANES; ++p)
+	{
+		if (planeMask & (1u << p)) std::fill_n(video.planes[p].begin(), video.Height() * video.RowWords(), 0);
+	}
+	MarkVideoChanged();
+}
 
 /**
  * @brief Returns from a subroutine.
  */
-void Chip8::OP_00EE() { --sp; pc = stack[sp]; }
+void Chip8::OP_00EE(Instruction const&) { pc = stack[--sp & (STACK_LEVELS - 1)]; }
 
 /**
  * @brief Jumps to address nnn.
  */
-void Chip8::OP_1nnn() { pc = opcode & 0x0FFFu; }
+void Chip8::OP_1nnn(Instruction const& in) { pc = in.nnn; }
 
 /**
  * @brief Calls subroutine at nnn.
  */
-void Chip8::OP_2nnn() { stack[sp++] = pc; pc = opcode & 0x0FFFu; }
+void Chip8::OP_2nnn(Instruction const& in) { stack[sp++ & (STACK_LEVELS - 1)] = pc; pc = in.nnn; }
 
 /**
  * @brief Skips the next instruction if Vx equals kk.
  */
-void Chip8::OP_3xkk() { if (registers[(opcode & 0x0F00u) >> 8u] == (opcode & 0x00FFu)) pc += 2; }
+template <QuirkProfile P>
+void Chip8::OP_3xkk(Instruction const& in) { if (registers[in.x] == in.kk) SkipNext<P>(); }
 
 /**
  * @brief Skips the next instruction if Vx does not equal kk.
  */
-void Chip8::OP_4xkk() { if (registers[(opcode & 0x0F00u) >> 8u] != (opcode & 0x00FFu)) pc += 2; }
+template <QuirkProfile P>
+void Chip8::OP_4xkk(Instruction const& in) { if (registers[in.x] != in.kk) SkipNext<P>(); }
 
 /**
  * @brief Skips the next instruction if Vx equals Vy.
  */
-void Chip8::OP_5xy0() { if (registers[(opcode & 0x0F00u) >> 8u] == registers[(opcode & 0x00F0u) >> 4u]) pc += 2; }
+template <QuirkProfile P>
+void Chip8::OP_5xy0(Instruction const& in) { if (registers[in.x] == registers[in.y]) SkipNext<P>(); }
 
 /**
  * @brief Sets Vx to kk.
  */
-void Chip8::OP_6xkk() { registers[(opcode & 0x0F00u) >> 8u] = opcode & 0x00FFu; }
+void Chip8::OP_6xkk(Instruction const& in) { registers[in.x] = in.kk; }
 
 /**
  * @brief Adds kk to Vx.
  */
-void Chip8::OP_7xkk() { registers[(opcode & 0x0F00u) >> 8u] += opcode & 0x00FFu; }
+void Chip8::OP_7xkk(Instruction const& in) { registers[in.x] += in.kk; }
 
 /**
  * @brief Sets Vx to the value of Vy.
  */
-void Chip8::OP_8xy0() { registers[(opcode & 0x0F00u) >> 8u] = registers[(opcode & 0x00F0u) >> 4u]; }
+void Chip8::OP_8xy0(Instruction const& in) { registers[in.x] = registers[in.y]; }
 
 /**
- * @brief Sets Vx to Vx OR Vy.
+ * @brief Sets Vx to Vx OR Vy. The COSMAC VIP also clears VF.
  */
-void Chip8::OP_8xy1() { registers[(opcode & 0x0F00u) >> 8u] |= registers[(opcode & 0x00F0u) >> 4u]; }
+template <QuirkProfile P>
+void Chip8::OP_8xy1(Instruction const& in)
+{
+	registers[in.x] |= registers[in.y];
+	if constexpr (QuirksOf(P).resetVF) registers[0xF] = 0;
+}
 
 /**
- * @brief Sets Vx to Vx AND Vy.
+ * @brief Sets Vx to Vx AND Vy. The COSMAC VIP also clears VF.
  */
-void Chip8::OP_8xy2() { registers[(opcode & 0x0F00u) >> 8u] &= registers[(opcode & 0x00F0u) >> 4u]; }
+template <QuirkProfile P>
+void Chip8::OP_8xy2(Instruction const& in)
+{
+	registers[in.x] &= registers[in.y];
+	if constexpr (QuirksOf(P).resetVF) registers[0xF] = 0;
+}
 
 /**
- * @brief Sets Vx to Vx XOR Vy.
+ * @brief Sets Vx to Vx XOR Vy. The COSMAC VIP also clears VF.
  */
-void Chip8::OP_8xy3() { registers[(opcode & 0x0F00u) >> 8u] ^= registers[(opcode & 0x00F0u) >> 4u]; }
+template <QuirkProfile P>
+void Chip8::OP_8xy3(Instruction const& in)
+{
+	registers[in.x] ^= registers[in.y];
+	if constexpr (QuirksOf(P).resetVF) registers[0xF] = 0;
+}
 
 /**
  * @brief Adds Vy to Vx. VF is set to 1 when there's a carry, and to 0 when there isn't.
  */
-void Chip8::OP_8xy4()
+void Chip8::OP_8xy4(Instruction const& in)
 {
-	uint8_t Vx = (opcode & 0x0F00u) >> 8u;
-	uint8_t Vy = (opcode & 0x00F0u) >> 4u;
+	uint8_t Vx = in.x;
+	uint8_t Vy = in.y;
 	uint16_t sum = registers[Vx] + registers[Vy];
 
 	registers[0xF] = sum > 255U ? 1 : 0;
@@ -240,113 +1272,174 @@ void Chip8::OP_8xy4()
 /**
  * @brief Subtracts Vy from Vx. VF is set to 0 when there's a borrow, and 1 when there isn't.
  */
-void Chip8::OP_8xy5()
+void Chip8::OP_8xy5(Instruction const& in)
 {
-	uint8_t Vx = (opcode & 0x0F00u) >> 8u;
-	uint8_t Vy = (opcode & 0x00F0u) >> 4u;
+	uint8_t Vx = in.x;
+	uint8_t Vy = in.y;
 	registers[0xF] = registers[Vx] > registers[Vy] ? 1 : 0;
 	registers[Vx] -= registers[Vy];
 }
 
 /**
  * @brief Stores the least significant bit of Vx in VF and then shifts Vx to the right by 1.
+ * The COSMAC VIP shifts Vy into Vx instead, setting VF last.
  */
-void Chip8::OP_8xy6()
+template <QuirkProfile P>
+void Chip8::OP_8xy6(Instruction const& in)
 {
-	uint8_t Vx = (opcode & 0x0F00u) >> 8u;
-	registers[0xF] = registers[Vx] & 0x1u;
-	registers[Vx] >>= 1;
+	uint8_t Vx = in.x;
+	if constexpr (QuirksOf(P).shiftVy)
+	{
+		uint8_t value = registers[in.y];
+		registers[Vx] = value >> 1;
+		registers[0xF] = value & 0x1u;
+	}
+	else
+	{
+		registers[0xF] = registers[Vx] & 0x1u;
+		registers[Vx] >>= 1;
+	}
 }
 
 /**
  * @brief Sets Vx to Vy minus Vx. VF is set to 0 when there's a borrow, and 1 when there isn't.
  */
-void Chip8::OP_8xy7()
+void Chip8::OP_8xy7(Instruction const& in)
 {
-	uint8_t Vx = (opcode & 0x0F00u) >> 8u;
-	uint8_t Vy = (opcode & 0x00F0u) >> 4u;
+	uint8_t Vx = in.x;
+	uint8_t Vy = in.y;
 	registers[0xF] = registers[Vy] > registers[Vx] ? 1 : 0;
 	registers[Vx] = registers[Vy] - registers[Vx];
 }
 
 /**
  * @brief Stores the most significant bit of Vx in VF and then shifts Vx to the left by 1.
+ * The COSMAC VIP shifts Vy into Vx instead, setting VF last.
  */
-void Chip8::OP_8xyE()
+template <QuirkProfile P>
+void Chip8::OP_8xyE(Instruction const& in)
 {
-	uint8_t Vx = (opcode & 0x0F00u) >> 8u;
-	registers[0xF] = (registers[Vx] & 0x80u) >> 7u;
-	registers[Vx] <<= 1;
+	uint8_t Vx = in.x;
+	if constexpr (QuirksOf(P).shiftVy)
+	{
+		uint8_t value = registers[in.y];
+		registers[Vx] = static_cast<uint8_t>(value << 1);
+		registers[0xF] = (value & 0x80u) >> 7u;
+	}
+	else
+	{
+		registers[0xF] = (registers[Vx] & 0x80u) >> 7u;
+		registers[Vx] <<= 1;
+	}
 }
 
 /**
  * @brief Skips the next instruction if Vx does not equal Vy.
  */
-void Chip8::OP_9xy0() { if (registers[(opcode & 0x0F00u) >> 8u] != registers[(opcode & 0x00F0u) >> 4u]) pc += 2; }
+template <QuirkProfile P>
+void Chip8::OP_9xy0(Instruction const& in) { if (registers[in.x] != registers[in.y]) SkipNext<P>(); }
 
 /**
  * @brief Sets the index register to nnn.
  */
-void Chip8::OP_Annn() { index = opcode & 0x0FFFu; }
+void Chip8::OP_Annn(Instruction const& in) { index = in.nnn; }
 
 /**
- * @brief Jumps to the address nnn plus V0.
+ * @brief Jumps to the address nnn plus V0. SUPER-CHIP reads it as Bxnn and adds Vx instead.
  */
-void Chip8::OP_Bnnn() { pc = registers[0] + (opcode & 0x0FFFu); }
+template <QuirkProfile P>
+void Chip8::OP_Bnnn(Instruction const& in) { pc = registers[QuirksOf(P).jumpVx ? in.x : 0] + in.nnn; }
 
 /**
  * @brief Sets Vx to a random byte AND kk.
  */
-void Chip8::OP_Cxkk() { registers[(opcode & 0x0F00u) >> 8u] = randByte(randGen) & (opcode & 0x00FFu); }
+void Chip8::OP_Cxkk(Instruction const& in) { registers[in.x] = random.NextByte() & in.kk; }
 
 /**
  * @brief Draws a sprite at coordinate (Vx, Vy) with a width of 8 pixels and a height of n pixels.
  * Each row of 8 pixels is read as bit-coded starting from memory location I.
  * VF is set to 1 if any screen pixels are flipped from set to unset when the sprite is drawn, and to 0 if that doesn't happen.
+ * 
+ * The starting position wraps around the screen, but the sprite itself is clipped at the right and bottom edges,
+ * unless the profile wraps sprites, in which case rows rotate into place and continue at the top.
+ * Each sprite row is placed with a single shift, tested for collision with one AND, and drawn with one XOR.
+ * Drawing any row bumps VideoGeneration() for the frontend.
+ * 
+ * SUPER-CHIP and XO-CHIP draw in either resolution, Dxy0 draws a 16x16 sprite from 32 bytes, and XO-CHIP
+ * draws into each plane selected with Fn01 in turn, reading the next sprite's worth of bytes for each.
  */
-void Chip8::OP_Dxyn()
+template <QuirkProfile P>
+void Chip8::OP_Dxyn(Instruction const& in)
 {
-	uint8_t Vx = (opcode & 0x0F00u) >> 8u;
-	uint8_t Vy = (opcode & 0x00F0u) >> 4u;
-	uint8_t height = opcode & 0x000Fu;
+	if constexpr (QuirksOf(P).superChip)
+	{
+		DrawSprite<P>(in);
+		return;
+	}
+
+	uint8_t Vx = in.x;
+	uint8_t Vy = in.y;
+	uint8_t height = in.n;
 	uint8_t xPos = registers[Vx] % VIDEO_WIDTH;
 	uint8_t yPos = registers[Vy] % VIDEO_HEIGHT;
-	registers[0xF] = 0;
+	uint64_t collision = 0;
+	VideoBuffer::Plane& rows = video.planes[0];
 
-	for (unsigned int row = 0; row < height; ++row)
+	if constexpr (QuirksOf(P).wrapSprites)
 	{
-		uint8_t spriteByte = memory[index + row];
-		for (unsigned int col = 0; col < 8; ++col)
+		for (unsigned int row = 0; row < height; ++row)
 		{
-			uint8_t spritePixel = spriteByte & (0x80u >> col);
-			uint32_t& screenPixel = video[(yPos + row) * VIDEO_WIDTH + (xPos + col)];
-			if (spritePixel && screenPixel == 0xFFFFFFFF) registers[0xF] = 1;
-			if (spritePixel) screenPixel ^= 0xFFFFFFFF;
+			uint64_t sprite = static_cast<uint64_t>(memory[(index + row) & (MEMORY_SIZE - 1)]) << 56u;
+			uint64_t spriteRow = (sprite >> xPos) | (xPos ? sprite << (VIDEO_WIDTH - xPos) : 0);
+			unsigned int y = (yPos + row) % VIDEO_HEIGHT;
+			collision |= rows[y] & spriteRow;
+			rows[y] ^= spriteRow;
 		}
+
+		if (height > 0) MarkVideoChanged();
 	}
+	else
+	{
+		unsigned int drawn = std::min<unsigned int>(height, VIDEO_HEIGHT - yPos);
+
+		for (unsigned int row = 0; row < drawn; ++row)
+		{
+			uint64_t spriteRow = (static_cast<uint64_t>(memory[(index + row) & (MEMORY_SIZE - 1)]) << 56u) >> xPos;
+			collision |= rows[yPos + row] & spriteRow;
+			rows[yPos + row] ^= spriteRow;
+		}
+
+		if (drawn > 0) MarkVideoChanged();
+	}
+
+	registers[0xF] = collision ? 1 : 0;
 }
 
 /**
  * @brief Skips the next instruction if the key stored in Vx is pressed.
  */
-void Chip8::OP_Ex9E() { if (keypad[registers[(opcode & 0x0F00u) >> 8u]]) pc += 2; }
+template <QuirkProfile P>
+void Chip8::OP_Ex9E(Instruction const& in) { if (keypad[registers[in.x] & (KEY_COUNT - 1)]) SkipNext<P>(); }
 
 /**
  * @brief Skips the next instruction if the key stored in Vx is not pressed.
  */
-void Chip8::OP_ExA1() { if (!keypad[registers[(opcode & 0x0F00u) >> 8u]]) pc += 2; }
+template <QuirkProfile P>
+void Chip8::OP_ExA1(Instruction const& in) { if (!keypad[registers[in.x] & (KEY_COUNT - 1)]) SkipNext<P>(); }
 
 /**
  * @brief Sets Vx to the value of the delay timer.
  */
-void Chip8::OP_Fx07() { registers[(opcode & 0x0F00u) >> 8u] = delayTimer; }
+void Chip8::OP_Fx07(Instruction const& in) { registers[in.x] = delayTimer; }
 
 /**
  * @brief A blocking operation that waits for a key press, then stores the value of the key in Vx.
+ * 
+ * With no key down, pc goes back to the instruction and the machine halts until Run() sees a key.
  */
-void Chip8::OP_Fx0A()
+void Chip8::OP_Fx0A(Instruction const& in)
 {
-	uint8_t Vx = (opcode & 0x0F00u) >> 8u;
+	uint8_t Vx = in.x;
 	for (uint8_t i = 0; i < 16; ++i)
 	{
 		if (keypad[i])
@@ -356,43 +1449,49 @@ void Chip8::OP_Fx0A()
 		}
 	}
 	pc -= 2;
+	waitingForKey = true;
 }
 
 /**
  * @brief Sets the delay timer to Vx.
  */
-void Chip8::OP_Fx15() { delayTimer = registers[(opcode & 0x0F00u) >> 8u]; }
+void Chip8::OP_Fx15(Instruction const& in) { delayTimer = registers[in.x]; }
 
 /**
  * @brief Sets the sound timer to Vx.
  */
-void Chip8::OP_Fx18() { soundTimer = registers[(opcode & 0x0F00u) >> 8u]; }
+void Chip8::OP_Fx18(Instruction const& in) { soundTimer = registers[in.x]; }
 
 /**
  * @brief Adds Vx to I. VF is not affected.
  */
-void Chip8::OP_Fx1E() { index += registers[(opcode & 0x0F00u) >> 8u]; }
+void Chip8::OP_Fx1E(Instruction const& in) { index += registers[in.x]; }
 
 /**
  * @brief Sets I to the location of the sprite for the digit Vx.
  */
-void Chip8::OP_Fx29() { index = FONTSET_START_ADDRESS + (5 * registers[(opcode & 0x0F00u) >> 8u]); }
+void Chip8::OP_Fx29(Instruction const& in) { index = FONTSET_START_ADDRESS + (5 * registers[in.x]); }
 
 /**
  * @brief Stores the binary-coded decimal representation of the value in register Vx at memory locations I, I+1, and I+2.
  * 
  * This function extracts the value from the register Vx, which is determined by the lower 12 bits of the opcode.
  * It then calculates the hundreds, tens, and units digits of the value and stores them in consecutive memory locations
- * starting from the address stored in the index register.
+ * starting from the address stored in the index register. Any decoded instructions it overwrites are invalidated.
+ * Addresses wrap at the end of the profile's memory.
  * 
  * Opcode: Fx33
  */
-void Chip8::OP_Fx33()
+template <QuirkProfile P>
+void Chip8::OP_Fx33(Instruction const& in)
 {
-    uint8_t Vx = registers[(opcode & 0x0F00u) >> 8u];
-    memory[index + 2] = Vx % 10;          // Store the units digit
-    memory[index + 1] = (Vx / 10) % 10;   // Store the tens digit
-    memory[index] = (Vx / 100) % 10;      // Store the hundreds digit
+    constexpr unsigned int ADDRESS_MASK = MemorySizeOf(P) - 1;
+    uint8_t* mem = MemoryOf<P>();
+    uint8_t Vx = registers[in.x];
+    mem[(index + 2) & ADDRESS_MASK] = Vx % 10;          // Store the units digit
+    mem[(index + 1) & ADDRESS_MASK] = (Vx / 10) % 10;   // Store the tens digit
+    mem[index & ADDRESS_MASK] = (Vx / 100) % 10;        // Store the hundreds digit
+    InvalidateCode(index, 3);
 }
 
 /**
@@ -400,12 +1499,20 @@ void Chip8::OP_Fx33()
  * 
  * This function copies the values from the registers V0 through Vx into consecutive memory locations
  * starting from the address stored in the index register. The register Vx is determined by the lower 12 bits of the opcode.
+ * Any decoded instructions it overwrites are invalidated. Addresses wrap at the end of the profile's memory.
+ * 
+ * On the COSMAC VIP, I is left pointing past the last register stored.
  * 
  * Opcode: Fx55
  */
-void Chip8::OP_Fx55() 
+template <QuirkProfile P>
+void Chip8::OP_Fx55(Instruction const& in) 
 { 
-    std::copy(registers.begin(), registers.begin() + ((opcode & 0x0F00u) >> 8u) + 1, memory.begin() + index); 
+    constexpr unsigned int ADDRESS_MASK = MemorySizeOf(P) - 1;
+    uint8_t* mem = MemoryOf<P>();
+    for (unsigned int r = 0; r <= in.x; ++r) mem[(index + r) & ADDRESS_MASK] = registers[r];
+    InvalidateCode(index, in.x + 1u);
+    if constexpr (QuirksOf(P).incrementIndex) index += in.x + 1u;
 }
 
 /**
@@ -413,10 +1520,348 @@ void Chip8::OP_Fx55()
  * 
  * This function copies values from consecutive memory locations starting from the address stored in the index register
  * into the registers V0 through Vx. The register Vx is determined by the lower 12 bits of the opcode.
+ * Addresses wrap at the end of the profile's memory.
+ * 
+ * On the COSMAC VIP, I is left pointing past the last register loaded.
  * 
  * Opcode: Fx65
  */
-void Chip8::OP_Fx65() 
+template <QuirkProfile P>
+void Chip8::OP_Fx65(Instruction const& in) 
 { 
-    std::copy(memory.begin() + index, memory.begin() + index + ((opcode & 0x0F00u) >> 8u) + 1, registers.begin()); 
-}
\ No newline at end of file
+    constexpr unsigned int ADDRESS_MASK = MemorySizeOf(P) - 1;
+    uint8_t const* mem = MemoryOf<P>();
+    for (unsigned int r = 0; r <= in.x; ++r) registers[r] = mem[(index + r) & ADDRESS_MASK];
+    if constexpr (QuirksOf(P).incrementIndex) index += in.x + 1u;
+}
+/**
+ * @brief Draws a sprite the way SUPER-CHIP and XO-CHIP do, in the current resolution.
+ * 
+ * Dxy0 draws a 16x16 sprite, two bytes per row. A sprite row is at most 16 pixels, so in high resolution
+ * it lands in the word holding x shifted right and spills into the next one shifted left; a wrapping
+ * profile moves what spills past the right edge into the first word. Each selected plane gets its own
+ * sprite, read from memory right after the previous plane's.
+ */
+template <QuirkProfile P>
+void Chip8::DrawSprite(Instruction const& in)
+{
+	constexpr unsigned int ADDRESS_MASK = MemorySizeOf(P) - 1;
+	uint8_t const* mem = MemoryOf<P>();
+
+	const unsigned int height = video.Height();
+	const unsigned int words = video.RowWords();
+	const unsigned int xPos = registers[in.x] & (video.Width() - 1);
+	const unsigned int yPos = registers[in.y] & (height - 1);
+	const bool wide = in.n == 0;
+	const unsigned int spriteRows = wide ? 16 : in.n;
+	const unsigned int rowBytes = wide ? 2 : 1;
+	const unsigned int drawn = QuirksOf(P).wrapSprites ? spriteRows : std::min(spriteRows, height - yPos);
+	const unsigned int shift = xPos & 63u;
+	unsigned int address = index;
+	uint64_t collision = 0;
+
+	for (unsigned int p = 0; p < VIDEO_PLANES; ++p)
+	{
+		if (!(planeMask & (1u << p))) continue;
+		uint64_t* plane = video.planes[p].data();
+
+		for (unsigned int row = 0; row < drawn; ++row)
+		{
+			unsigned int a = address + row * rowBytes;
+			uint64_t sprite = static_cast<uint64_t>(mem[a & ADDRESS_MASK]) << 56u;
+			if (wide) sprite |= static_cast<uint64_t>(mem[(a + 1) & ADDRESS_MASK]) << 48u;
+
+			uint64_t* dst = plane + ((yPos + row) & (height - 1)) * words;
+			uint64_t near = sprite >> shift;
+			uint64_t spill = shift ? sprite << (64u - shift) : 0;
+
+			if (words == 1)
+			{
+				uint64_t spriteRow = near | (QuirksOf(P).wrapSprites ? spill : 0);
+				collision |= dst[0] & spriteRow;
+				dst[0] ^= spriteRow;
+			}
+			else
+			{
+				uint64_t left = xPos < 64 ? near : (QuirksOf(P).wrapSprites ? spill : 0);
+				uint64_t right = xPos < 64 ? spill : near;
+				collision |= (dst[0] & left) | (dst[1] & right);
+				dst[0] ^= left;
+				dst[1] ^= right;
+			}
+		}
+
+		address += spriteRows * rowBytes;
+	}
+
+	if (drawn > 0 && planeMask) MarkVideoChanged();
+
+	registers[0xF] = collision ? 1 : 0;
+}
+
+/**
+ * @brief Switches the display resolution and clears every plane.
+ */
+void Chip8::SetHires(bool hires)
+{
+	video.hires = hires;
+	for (VideoBuffer::Plane& plane : video.planes) plane.fill(0);
+	MarkVideoChanged();
+}
+
+/**
+ * @brief Scrolls the selected planes by whole rows, moving the rows with one memmove per plane
+ * and clearing the ones scrolled in.
+ * 
+ * @param rows Rows to scroll, down if positive and up if negative.
+ */
+void Chip8::ScrollRows(int rows)
+{
+	const unsigned int words = video.RowWords();
+	const unsigned int total = video.Height() * words;
+	const unsigned int moved = std::min<unsigned int>(rows < 0 ? -rows : rows, video.Height()) * words;
+
+	for (unsigned int p = 0; p < VIDEO_PLANES; ++p)
+	{
+		if (!(planeMask & (1u << p))) continue;
+		uint64_t* plane = video.planes[p].data();
+
+		if (rows > 0)
+		{
+			std::memmove(plane + moved, plane, (total - moved) * sizeof(uint64_t));
+			std::fill_n(plane, moved, 0);
+		}
+		else
+		{
+			std::memmove(plane, plane + moved, (total - moved) * sizeof(uint64_t));
+			std::fill_n(plane + total - moved, moved, 0);
+		}
+	}
+
+	MarkVideoChanged();
+}
+
+/**
+ * @brief Scrolls the selected planes sideways by shifting each row's words, carrying bits from one
+ * word to the other in high resolution.
+ * 
+ * @param pixels Pixels to scroll, right if positive and left if negative; fewer than 64 either way.
+ */
+void Chip8::ScrollPixels(int pixels)
+{
+	const unsigned int shift = pixels < 0 ? -pixels : pixels;
+	if (shift == 0) return;
+
+	for (unsigned int p = 0; p < VIDEO_PLANES; ++p)
+	{
+		if (!(planeMask & (1u << p))) continue;
+		VideoBuffer::Plane& plane = video.planes[p];
+
+		for (unsigned int y = 0; y < video.Height(); ++y)
+		{
+			if (!video.hires)
+			{
+				plane[y] = pixels > 0 ? plane[y] >> shift : plane[y] << shift;
+				continue;
+			}
+
+			uint64_t& left = plane[2 * y];
+			uint64_t& right = plane[2 * y + 1];
+			if (pixels > 0)
+			{
+				right = (right >> shift) | (left << (64u - shift));
+				left >>= shift;
+			}
+			else
+			{
+				left = (left << shift) | (right >> (64u - shift));
+				right <<= shift;
+			}
+		}
+	}
+
+	MarkVideoChanged();
+}
+
+/**
+ * @brief Scrolls the display down n rows (SUPER-CHIP).
+ */
+template <QuirkProfile P>
+void Chip8::OP_00Cn(Instruction const& in)
+{
+	if constexpr (QuirksOf(P).superChip) ScrollRows(in.n);
+}
+
+/**
+ * @brief Scrolls the display up n rows (XO-CHIP).
+ */
+template <QuirkProfile P>
+void Chip8::OP_00Dn(Instruction const& in)
+{
+	if constexpr (QuirksOf(P).xoChip) ScrollRows(-static_cast<int>(in.n));
+}
+
+/**
+ * @brief Scrolls the display right 4 pixels (SUPER-CHIP).
+ */
+template <QuirkProfile P>
+void Chip8::OP_00FB(Instruction const&)
+{
+	if constexpr (QuirksOf(P).superChip) ScrollPixels(4);
+}
+
+/**
+ * @brief Scrolls the display left 4 pixels (SUPER-CHIP).
+ */
+template <QuirkProfile P>
+void Chip8::OP_00FC(Instruction const&)
+{
+	if constexpr (QuirksOf(P).superChip) ScrollPixels(-4);
+}
+
+/**
+ * @brief Exits the interpreter (SUPER-CHIP). There is nothing to return to, so pc stays on the
+ * instruction and the machine spins there.
+ */
+template <QuirkProfile P>
+void Chip8::OP_00FD(Instruction const&)
+{
+	if constexpr (QuirksOf(P).superChip) pc -= 2;
+}
+
+/**
+ * @brief Switches to the 64x32 low-resolution display (SUPER-CHIP).
+ */
+template <QuirkProfile P>
+void Chip8::OP_00FE(Instruction const&)
+{
+	if constexpr (QuirksOf(P).superChip) SetHires(false);
+}
+
+/**
+ * @brief Switches to the 128x64 high-resolution display (SUPER-CHIP).
+ */
+template <QuirkProfile P>
+void Chip8::OP_00FF(Instruction const&)
+{
+	if constexpr (QuirksOf(P).superChip) SetHires(true);
+}
+
+/**
+ * @brief Stores registers Vx through Vy, in that order even if x > y, in memory starting at location I,
+ * leaving I unchanged (XO-CHIP). Elsewhere this is 5xy0.
+ */
+template <QuirkProfile P>
+void Chip8::OP_5xy2(Instruction const& in)
+{
+	if constexpr (QuirksOf(P).xoChip)
+	{
+		const unsigned int count = (in.x > in.y ? in.x - in.y : in.y - in.x) + 1u;
+		const int step = in.x <= in.y ? 1 : -1;
+		uint8_t* mem = MemoryOf<P>();
+		for (unsigned int i = 0; i < count; ++i)
+		{
+			mem[(index + i) & (XO_MEMORY_SIZE - 1)] = registers[in.x + step * static_cast<int>(i)];
+		}
+		InvalidateCode(index, count);
+	}
+	else
+	{
+		OP_5xy0<P>(in);
+	}
+}
+
+/**
+ * @brief Reads registers Vx through Vy, in that order even if x > y, from memory starting at location I,
+ * leaving I unchanged (XO-CHIP). Elsewhere this is 5xy0.
+ */
+template <QuirkProfile P>
+void Chip8::OP_5xy3(Instruction const& in)
+{
+	if constexpr (QuirksOf(P).xoChip)
+	{
+		const unsigned int count = (in.x > in.y ? in.x - in.y : in.y - in.x) + 1u;
+		const int step = in.x <= in.y ? 1 : -1;
+		uint8_t const* mem = MemoryOf<P>();
+		for (unsigned int i = 0; i < count; ++i)
+		{
+			registers[in.x + step * static_cast<int>(i)] = mem[(index + i) & (XO_MEMORY_SIZE - 1)];
+		}
+	}
+	else
+	{
+		OP_5xy0<P>(in);
+	}
+}
+
+/**
+ * @brief Sets I to the 16-bit word after the instruction and skips over it, reaching all of memory (XO-CHIP).
+ */
+template <QuirkProfile P>
+void Chip8::OP_F000(Instruction const&)
+{
+	if constexpr (QuirksOf(P).xoChip)
+	{
+		uint8_t const* mem = MemoryOf<P>();
+		index = static_cast<uint16_t>((mem[pc] << 8u) | mem[static_cast<uint16_t>(pc + 1)]);
+		pc += 2;
+	}
+}
+
+/**
+ * @brief Selects the planes that drawing, scrolling and clearing affect, one bit each (XO-CHIP).
+ */
+template <QuirkProfile P>
+void Chip8::OP_Fn01(Instruction const& in)
+{
+	if constexpr (QuirksOf(P).xoChip) planeMask = in.x & ((1u << VIDEO_PLANES) - 1);
+}
+
+/**
+ * @brief Loads the 16-byte audio pattern from memory starting at location I (XO-CHIP).
+ */
+template <QuirkProfile P>
+void Chip8::OP_F002(Instruction const&)
+{
+	if constexpr (QuirksOf(P).xoChip)
+	{
+		uint8_t const* mem = MemoryOf<P>();
+		for (unsigned int i = 0; i < AUDIO_PATTERN_SIZE; ++i) audioPattern[i] = mem[(index + i) & (XO_MEMORY_SIZE - 1)];
+	}
+}
+
+/**
+ * @brief Sets I to the location of the 8x10 sprite for the digit in the low nibble of Vx (SUPER-CHIP).
+ */
+template <QuirkProfile P>
+void Chip8::OP_Fx30(Instruction const& in)
+{
+	if constexpr (QuirksOf(P).superChip) index = BIGFONT_START_ADDRESS + 10 * (registers[in.x] & 0xFu);
+}
+
+/**
+ * @brief Sets the playback pitch of the audio pattern to Vx (XO-CHIP).
+ */
+template <QuirkProfile P>
+void Chip8::OP_Fx3A(Instruction const& in)
+{
+	if constexpr (QuirksOf(P).xoChip) pitch = registers[in.x];
+}
+
+/**
+ * @brief Stores registers V0 through Vx in the flag registers (SUPER-CHIP).
+ */
+template <QuirkProfile P>
+void Chip8::OP_Fx75(Instruction const& in)
+{
+	if constexpr (QuirksOf(P).superChip) std::copy(registers.begin(), registers.begin() + in.x + 1, flagRegisters.begin());
+}
+
+/**
+ * @brief Reads registers V0 through Vx from the flag registers (SUPER-CHIP).
+ */
+template <QuirkProfile P>
+void Chip8::OP_Fx85(Instruction const& in)
+{
+	if constexpr (QuirksOf(P).superChip) std::copy(flagRegisters.begin(), flagRegisters.begin() + in.x + 1, registers.begin());
+}
@@ -0,0 +1,461 @@
+#include "../include/Debugger.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define CHIP8_DEBUG_SOCKET_AVAILABLE
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+constexpr int DEBUG_POLL_MS = 20;            // Time the server waits for input before looking for stops again
+constexpr unsigned int DEBUG_MEM_MAX = 256;  // Bytes one mem command shows at most
+
+/**
+ * @brief Creates a detached debugger with no breakpoints or watchpoints.
+ *
+ * @param memorySize Bytes of memory of the machines it debugs, a power of two.
+ */
+Debugger::Debugger(unsigned int memorySize)
+	: addressMask(memorySize - 1),
+	  breakpoints(std::make_unique<std::atomic<uint64_t>[]>(memorySize / 64)),
+	  watched(std::make_unique<std::atomic<uint64_t>[]>(memorySize / 64))
+{
+}
+
+/**
+ * @brief Forgets every breakpoint, watchpoint and pending request, and lets a stopped machine run on.
+ */
+void Debugger::Detach()
+{
+	attached.store(false);
+	for (unsigned int word = 0; word < MemorySize() / 64; ++word)
+	{
+		breakpoints[word].store(0);
+		watched[word].store(0);
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	pauseRequested = false;
+	steps = 0;
+	frameStep = false;
+	UpdateInterrupt();
+	stoppedMachine = nullptr;
+	resumed.notify_all();
+}
+
+/**
+ * @brief Watches or stops watching every byte of a range.
+ *
+ * @param first The first address.
+ * @param last The last address, included.
+ * @param enabled Whether to watch the range.
+ */
+void Debugger::SetWatchpoint(uint16_t first, uint16_t last, bool enabled)
+{
+	for (unsigned int address = first; address <= last && address < MemorySize(); ++address)
+	{
+		Set(watched, address, enabled);
+	}
+}
+
+/**
+ * @brief Asks the machine to stop before its next instruction; nothing happens if it is stopped already.
+ */
+void Debugger::Pause()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (stoppedMachine) return;
+
+	pauseRequested = true;
+	UpdateInterrupt();
+}
+
+/**
+ * @brief Lets a stopped machine run, freely or for a number of instructions.
+ *
+ * A watchpoint stops the machine after the writing instruction, so the check before the next
+ * instruction comes first and is not counted as a step.
+ *
+ * @param instructions The number of instructions to execute before stopping again, 0 to run freely.
+ * @return false if the machine was not stopped.
+ */
+bool Debugger::Resume(unsigned int instructions)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (!stoppedMachine) return false;
+
+	steps = instructions != 0 && stopCheck == Check::Write ? instructions + 1 : instructions;
+	UpdateInterrupt();
+	stoppedMachine = nullptr;
+	resumed.notify_all();
+	return true;
+}
+
+/**
+ * @brief Lets a stopped machine run until the first instruction of its next frame.
+ *
+ * A machine halted in Fx0A runs no instructions, so it stops once a key lets it go on.
+ *
+ * @return false if the machine was not stopped.
+ */
+bool Debugger::StepFrame()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (!stoppedMachine) return false;
+
+	frameStep = true;
+	UpdateInterrupt();
+	stoppedMachine = nullptr;
+	resumed.notify_all();
+	return true;
+}
+
+/**
+ * @brief Returns the number of stops so far and why the machine stopped last.
+ *
+ * @param reason Receives the reason of the last stop.
+ * @param address Receives the breakpoint, pc or watched byte of the last stop.
+ * @return The number of stops.
+ */
+uint64_t Debugger::LastStop(StopReason& reason, uint16_t& address) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	reason = stopReason;
+	address = stopAddress;
+	return stopCount;
+}
+
+/**
+ * @brief Copies the registers, stack, timers and a range of memory of a stopped machine.
+ *
+ * @param snapshot Receives the state.
+ * @param first The first address of memory to copy.
+ * @param count The number of bytes to copy, up to the end of the machine's memory.
+ * @return false if the machine is not stopped.
+ */
+bool Debugger::Snapshot(DebugSnapshot& snapshot, unsigned int first, unsigned int count) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (!stoppedMachine) return false;
+
+	const unsigned int memorySize = MemorySizeOf(stoppedMachine->quirkProfile);
+	first = std::min(first, memorySize);
+	count = std::min(count, memorySize - first);
+	uint8_t const* memory = stoppedMachine->Memory();
+
+	snapshot.registers = stoppedMachine->registers;
+	snapshot.stack = stoppedMachine->stack;
+	snapshot.memory.assign(memory + first, memory + first + count);
+	snapshot.pc = stoppedMachine->pc;
+	snapshot.index = stoppedMachine->index;
+	snapshot.sp = stoppedMachine->sp;
+	snapshot.delayTimer = stoppedMachine->delayTimer;
+	snapshot.soundTimer = stoppedMachine->soundTimer;
+	return true;
+}
+
+/**
+ * @brief Decides whether the machine stops here and, if so, blocks it until it is resumed or detached.
+ *
+ * A pause wins over everything else; a step running out, a frame step reaching a new frame and a
+ * breakpoint follow, in that order. Any stop cancels the requests still pending.
+ *
+ * @param chip8 The machine.
+ * @param check Where the machine asks.
+ * @param address The written byte for Check::Write, otherwise pc.
+ */
+void Debugger::Break(Chip8& chip8, Check check, uint16_t address)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	if (!attached.load()) return;
+
+	StopReason reason;
+	if (check == Check::Write) reason = StopReason::Watchpoint;
+	else if (pauseRequested) reason = StopReason::Pause;
+	else if (steps != 0 && --steps == 0) reason = StopReason::Step;
+	else if (frameStep && check == Check::FrameStart) reason = StopReason::Frame;
+	else if (Test(breakpoints, address)) reason = StopReason::Breakpoint;
+	else return;
+
+	pauseRequested = false;
+	steps = 0;
+	frameStep = false;
+	UpdateInterrupt();
+
+	stopReason = reason;
+	stopCheck = check;
+	stopAddress = address;
+	++stopCount;
+	stoppedMachine = &chip8;
+	resumed.wait(lock, [this] { return stoppedMachine == nullptr; });
+}
+
+/**
+ * @brief Binds the server to a debugger; nothing is accepted until Open().
+ *
+ * @param debugger The debugger to control.
+ */
+DebugServer::DebugServer(Debugger& debugger)
+	: debugger(debugger)
+{
+}
+
+/**
+ * @brief Closes the socket if it is still open.
+ */
+DebugServer::~DebugServer()
+{
+	Close();
+}
+
+/**
+ * @brief Creates the socket, replacing any socket file left at the path, and starts the server thread.
+ *
+ * @param socketPath The socket's file name.
+ * @return true if the socket was created; always false on hosts without Unix-domain sockets.
+ */
+bool DebugServer::Open(std::string const& socketPath)
+{
+#ifdef CHIP8_DEBUG_SOCKET_AVAILABLE
+	if (running.load()) return false;
+
+	sockaddr_un address{};
+	address.sun_family = AF_UNIX;
+	if (socketPath.empty() || socketPath.size() >= sizeof(address.sun_path)) return false;
+	socketPath.copy(address.sun_path, socketPath.size());
+
+	listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listener < 0) return false;
+
+	unlink(socketPath.c_str());
+	if (bind(listener, reinterpret_cast<sockaddr const*>(&address), sizeof(address)) != 0 || listen(listener, 1) != 0)
+	{
+		close(listener);
+		listener = -1;
+		return false;
+	}
+
+	path = socketPath;
+	running.store(true);
+	thread = std::thread(&DebugServer::Run, this);
+	return true;
+#else
+	(void)socketPath;
+	return false;
+#endif
+}
+
+/**
+ * @brief Blocks until a client has attached the debugger.
+ *
+ * @return false if the server was closed first.
+ */
+bool DebugServer::WaitForClient() const
+{
+	while (running.load() && !debugger.Attached())
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(DEBUG_POLL_MS));
+	}
+	return debugger.Attached();
+}
+
+/**
+ * @brief Stops the server thread, detaching the debugger, and removes the socket file.
+ */
+void DebugServer::Close()
+{
+#ifdef CHIP8_DEBUG_SOCKET_AVAILABLE
+	if (listener < 0) return;
+
+	running.store(false);
+	if (thread.joinable()) thread.join();
+
+	close(listener);
+	listener = -1;
+	unlink(path.c_str());
+#endif
+}
+
+/**
+ * @brief Accepts clients one at a time until the server closes.
+ */
+void DebugServer::Run()
+{
+#ifdef CHIP8_DEBUG_SOCKET_AVAILABLE
+	while (running.load())
+	{
+		pollfd waiting{listener, POLLIN, 0};
+		if (poll(&waiting, 1, DEBUG_POLL_MS) <= 0) continue;
+
+		int client = accept(listener, nullptr, nullptr);
+		if (client < 0) continue;
+
+		Serve(client);
+		close(client);
+	}
+#endif
+}
+
+/**
+ * @brief Attaches the debugger for a client, answers its commands and reports every stop, then detaches.
+ *
+ * @param client The client's socket.
+ */
+void DebugServer::Serve(int client)
+{
+#ifdef CHIP8_DEBUG_SOCKET_AVAILABLE
+#ifdef MSG_NOSIGNAL
+	constexpr int SEND_FLAGS = MSG_NOSIGNAL;   // A client that went away must not raise SIGPIPE
+#else
+	constexpr int SEND_FLAGS = 0;
+#endif
+	auto sendLine = [&](std::string const& line) {
+		std::string text = line + "\n";
+		return ::send(client, text.data(), text.size(), SEND_FLAGS) == static_cast<ssize_t>(text.size());
+	};
+
+	static char const* const reasonNames[] = {"pause", "step", "frame", "break", "watch"};
+
+	StopReason reason;
+	uint16_t address;
+	uint64_t stops = debugger.LastStop(reason, address);
+	debugger.Attach();
+
+	std::string input;
+	bool connected = true;
+	while (connected && running.load())
+	{
+		pollfd waiting{client, POLLIN, 0};
+		if (poll(&waiting, 1, DEBUG_POLL_MS) > 0)
+		{
+			char buffer[512];
+			ssize_t count = recv(client, buffer, sizeof(buffer), 0);
+			if (count <= 0) break;
+			input.append(buffer, static_cast<size_t>(count));
+
+			for (size_t end = input.find('\n'); connected && end != std::string::npos; end = input.find('\n'))
+			{
+				std::string line = input.substr(0, end);
+				input.erase(0, end + 1);
+				if (!line.empty() && line.back() == '\r') line.pop_back();
+				if (!line.empty()) connected = sendLine(Execute(line));
+			}
+		}
+
+		uint64_t latest = debugger.LastStop(reason, address);
+		if (connected && latest != stops)
+		{
+			char text[32];
+			std::snprintf(text, sizeof(text), "stopped %s 0x%03X", reasonNames[static_cast<size_t>(reason)], address);
+			connected = sendLine(text);
+			stops = latest;
+		}
+	}
+
+	debugger.Detach();
+#else
+	(void)client;
+#endif
+}
+
+/**
+ * @brief Executes one command and formats its reply.
+ *
+ * @param line The command line.
+ * @return The reply, without a line break.
+ */
+std::string DebugServer::Execute(std::string const& line)
+{
+	std::istringstream in(line);
+	std::string command;
+	in >> command;
+
+	// Addresses and ranges are hexadecimal, "<lo>" or "<lo>-<hi>"
+	auto range = [&](unsigned int& first, unsigned int& last) {
+		std::string text;
+		if (!(in >> text)) return false;
+		char* end = nullptr;
+		first = static_cast<unsigned int>(std::strtoul(text.c_str(), &end, 16));
+		last = *end == '-' ? static_cast<unsigned int>(std::strtoul(end + 1, &end, 16)) : first;
+		return *end == '\0' && end != text.c_str() && first <= last && last < debugger.MemorySize();
+	};
+
+	std::ostringstream reply;
+	unsigned int first = 0;
+	unsigned int last = 0;
+	DebugSnapshot snapshot;
+
+	if (command == "break" || command == "delete")
+	{
+		if (!range(first, last) || first != last) return "error expected an address";
+		debugger.SetBreakpoint(static_cast<uint16_t>(first), command == "break");
+	}
+	else if (command == "watch" || command == "unwatch")
+	{
+		if (!range(first, last)) return "error expected an address range";
+		debugger.SetWatchpoint(static_cast<uint16_t>(first), static_cast<uint16_t>(last), command == "watch");
+	}
+	else if (command == "pause")
+	{
+		debugger.Pause();
+	}
+	else if (command == "continue" || command == "step")
+	{
+		unsigned int count = 1;
+		if (command == "step" && !(in >> std::dec >> count)) count = 1;
+		if (!debugger.Resume(command == "step" ? std::max(count, 1u) : 0)) return "error running";
+	}
+	else if (command == "frame")
+	{
+		if (!debugger.StepFrame()) return "error running";
+	}
+	else if (command == "regs")
+	{
+		if (!debugger.Snapshot(snapshot)) return "error running";
+		char text[64];
+		std::snprintf(text, sizeof(text), "pc=0x%03X i=0x%03X sp=%u dt=%02X st=%02X v=",
+		              snapshot.pc, snapshot.index, snapshot.sp, snapshot.delayTimer, snapshot.soundTimer);
+		reply << text;
+		for (unsigned int reg = 0; reg < REGISTER_COUNT; ++reg)
+		{
+			std::snprintf(text, sizeof(text), "%s%02X", reg ? " " : "", snapshot.registers[reg]);
+			reply << text;
+		}
+	}
+	else if (command == "stack")
+	{
+		if (!debugger.Snapshot(snapshot)) return "error running";
+		char text[8];
+		for (unsigned int level = 0; level < snapshot.sp && level < STACK_LEVELS; ++level)
+		{
+			std::snprintf(text, sizeof(text), "%s0x%03X", level ? " " : "", snapshot.stack[level]);
+			reply << text;
+		}
+	}
+	else if (command == "mem")
+	{
+		unsigned int count = 16;
+		if (!range(first, last) || first != last) return "error expected an address";
+		if (!(in >> std::dec >> count)) count = 16;
+		if (!debugger.Snapshot(snapshot, first, std::min(count, DEBUG_MEM_MAX))) return "error running";
+		char text[4];
+		for (size_t i = 0; i < snapshot.memory.size(); ++i)
+		{
+			std::snprintf(text, sizeof(text), "%s%02X", i ? " " : "", snapshot.memory[i]);
+			reply << text;
+		}
+	}
+	else
+	{
+		return "error unknown command: " + command;
+	}
+
+	std::string text = reply.str();
+	return text.empty() ? "ok" : "ok " + text;
+}
@@ -0,0 +1,40 @@
+#include "../include/Display.hpp"
+#include <algorithm>
+
+/**
+ * @brief Expands the bit-packed display into 32-bit RGBA pixels.
+ * 
+ * Each pixel's color is looked up by its plane bits without branching, so the cost is the same
+ * for any screen contents.
+ * 
+ * @param video The display, in either resolution.
+ * @param pixels Destination of the first expanded row.
+ * @param pitch The number of bytes between the starts of two destination rows.
+ * @param firstRow The first row to expand.
+ * @param rowCount The number of rows to expand.
+ * @param palette The color of each combination of plane bits.
+ */
+void ExpandVideo(VideoBuffer const& video, uint32_t* pixels, int pitch, unsigned int firstRow, unsigned int rowCount,
+                 Palette const& palette)
+{
+	const unsigned int words = video.RowWords();
+	const unsigned int lastRow = std::min(firstRow + rowCount, video.Height());
+
+	for (unsigned int y = firstRow; y < lastRow; ++y)
+	{
+		uint32_t* dst = reinterpret_cast<uint32_t*>(reinterpret_cast<uint8_t*>(pixels) + (y - firstRow) * pitch);
+
+		for (unsigned int w = y * words; w < (y + 1) * words; ++w)
+		{
+			uint64_t low = video.planes[0][w];
+			uint64_t high = video.planes[1][w];
+
+			for (unsigned int x = 0; x < 64; ++x)
+			{
+				unsigned int shift = 63 - x;
+				unsigned int color = static_cast<unsigned int>((low >> shift) & 1u) | (static_cast<unsigned int>((high >> shift) & 1u) << 1);
+				*dst++ = palette[color];
+			}
+		}
+	}
+}
@@ -0,0 +1,104 @@
+#include "../include/EmulationThread.hpp"
+#include <chrono>
+
+constexpr std::chrono::milliseconds TURBO_SLICE{4};   // Time fast-forward runs frames back to back before looking at input again
+
+/**
+ * @brief Binds the thread to a machine and the scheduler that paces it; nothing runs until Start().
+ * 
+ * @param chip8 The machine to run.
+ * @param scheduler The scheduler that paces it.
+ */
+EmulationThread::EmulationThread(Chip8& chip8, FrameScheduler& scheduler)
+	: chip8(chip8), scheduler(scheduler)
+{
+}
+
+/**
+ * @brief Stops the thread if it is still running.
+ */
+EmulationThread::~EmulationThread()
+{
+	Stop();
+}
+
+/**
+ * @brief Publishes the current display as the first frame and starts running the machine.
+ */
+void EmulationThread::Start()
+{
+	if (running.exchange(true)) return;
+
+	frames.Back() = chip8.video;
+	frames.Publish();
+
+	thread = std::thread(&EmulationThread::Run, this);
+}
+
+/**
+ * @brief Stops running the machine and waits for the thread to finish its frame.
+ */
+void EmulationThread::Stop()
+{
+	running.store(false);
+	if (thread.joinable()) thread.join();
+}
+
+/**
+ * @brief Runs every due frame, publishes the display when it changed, then sleeps until the next frame.
+ * 
+ * Pacing depends only on the steady clock, never on the consumer: frames nobody took in time
+ * are replaced by newer ones, and the keypad and rewind switch are sampled once per pass.
+ * A machine halted in Fx0A costs next to nothing per pass, and publishes nothing until it draws.
+ * Fast-forward runs frames back to back in short slices instead, without sleeping; the consumer
+ * is only woken for a frame when it took the previous one, so it is never flooded.
+ */
+void EmulationThread::Run()
+{
+	using Clock = std::chrono::steady_clock;
+
+	uint32_t publishedGeneration = chip8.VideoGeneration();
+	auto lastTime = Clock::now();
+
+	while (running.load(std::memory_order_relaxed))
+	{
+		for (unsigned int key = 0; key < KEY_COUNT; ++key)
+		{
+			chip8.keypad[key] = keys[key].load(std::memory_order_relaxed);
+		}
+		scheduler.SetRewinding(rewinding.load(std::memory_order_relaxed));
+
+		auto currentTime = Clock::now();
+		double dt = std::chrono::duration<double>(currentTime - lastTime).count();
+		lastTime = currentTime;
+
+		unsigned int ran = 0;
+		bool fastForward = turbo.load(std::memory_order_relaxed);
+		if (fastForward)
+		{
+			auto sliceEnd = currentTime + TURBO_SLICE;
+			do
+			{
+				scheduler.RunFrame(chip8);
+				++ran;
+			} while (Clock::now() < sliceEnd);
+		}
+		else
+		{
+			ran = scheduler.Advance(chip8, dt);
+		}
+
+		if (ran > 0 && chip8.VideoGeneration() != publishedGeneration)
+		{
+			frames.Back() = chip8.video;
+			bool taken = frames.Publish();
+			publishedGeneration = chip8.VideoGeneration();
+			if (taken && frameListener) frameListener();
+		}
+
+		if (!fastForward)
+		{
+			std::this_thread::sleep_until(currentTime + std::chrono::duration<double>(scheduler.TimeUntilNextFrame()));
+		}
+	}
+}
@@ -0,0 +1,87 @@
+#include "../include/FrameScheduler.hpp"
+#include "../include/Movie.hpp"
+#include "../include/Rewind.hpp"
+#include <algorithm>
+#include <cmath>
+
+constexpr double FRAME_PERIOD = 1.0 / TIMER_FREQUENCY;
+
+/**
+ * @brief Constructs a scheduler with the given per-frame instruction budget.
+ * 
+ * @param instructionsPerFrame The number of instructions executed per 60 Hz frame.
+ */
+FrameScheduler::FrameScheduler(unsigned int instructionsPerFrame)
+	: instructionsPerFrame(instructionsPerFrame)
+{
+}
+
+/**
+ * @brief Accounts for elapsed host time and runs every frame that has become due.
+ * 
+ * Host time counts times the speed set with SetSpeed(). If the host stalled for longer than
+ * MAX_CATCHUP_FRAMES frames (scaled by the speed), the backlog is dropped rather than replayed
+ * all at once. With a rewind history attached, each frame run is recorded, and while rewinding
+ * each due frame steps back one recorded frame instead. With a movie attached, the keypad each
+ * frame runs with is recorded.
+ * 
+ * @param chip8 The machine to run.
+ * @param elapsedSeconds Host time since the previous call.
+ * @return The number of frames executed.
+ */
+unsigned int FrameScheduler::Advance(Chip8& chip8, double elapsedSeconds)
+{
+	accumulator += elapsedSeconds * speed;
+
+	unsigned int frames = 0;
+	while (accumulator >= FRAME_PERIOD && frames < maxFrames)
+	{
+		RunFrame(chip8);
+		accumulator -= FRAME_PERIOD;
+		++frames;
+	}
+
+	// Drop whatever backlog remains after a long stall
+	if (accumulator >= FRAME_PERIOD) accumulator = 0.0;
+
+	return frames;
+}
+
+/**
+ * @brief Runs one frame right away: steps back one recorded frame while rewinding, otherwise
+ * runs the machine and records the frame.
+ * 
+ * @param chip8 The machine to run.
+ */
+void FrameScheduler::RunFrame(Chip8& chip8)
+{
+	if (rewind && rewinding)
+	{
+		if (rewind->StepBack(chip8) && movie) movie->DropFrame();
+	}
+	else
+	{
+		if (movie) movie->Record(chip8.keypad);
+		chip8.RunFrame(instructionsPerFrame);
+		if (rewind) rewind->Push(chip8);
+	}
+}
+
+/**
+ * @brief Scales emulated time against host time.
+ * 
+ * @param multiplier The speed, above zero.
+ */
+void FrameScheduler::SetSpeed(double multiplier)
+{
+	speed = multiplier;
+	maxFrames = static_cast<unsigned int>(std::ceil(MAX_CATCHUP_FRAMES * std::max(multiplier, 1.0)));
+}
+
+/**
+ * @brief Returns the host time left until the next frame is due at the current speed, in seconds.
+ */
+double FrameScheduler::TimeUntilNextFrame() const
+{
+	return (FRAME_PERIOD - accumulator) / speed;
+}
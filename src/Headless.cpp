@@ -0,0 +1,453 @@
+#include "../include/Batch.hpp"
+#include "../include/Chip8.hpp"
+#include "../include/Debugger.hpp"
+#include "../include/Lockstep.hpp"
+#include "../include/Movie.hpp"
+#include "../include/Tracer.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Instructions executed per emulated 60 Hz frame
+constexpr unsigned int DEFAULT_INSTRUCTIONS_PER_FRAME = 10;
+
+/**
+ * @brief Parses a backend name given on the command line.
+ * 
+ * @param name The backend name.
+ * @param backend Receives the backend if the name is valid.
+ * @return true if the name is valid.
+ */
+static bool ParseBackend(char const* name, Backend& backend)
+{
+    if (std::strcmp(name, "table") == 0)    { backend = Backend::Table;    return true; }
+    if (std::strcmp(name, "switch") == 0)   { backend = Backend::Switch;   return true; }
+    if (std::strcmp(name, "threaded") == 0) { backend = Backend::Threaded; return true; }
+    if (std::strcmp(name, "jit") == 0)      { backend = Backend::Jit;      return true; }
+    return false;
+}
+
+/**
+ * @brief Writes a machine's execution counts as JSON (for a .json file name) or CSV.
+ * 
+ * Every handler is listed; addresses only when they executed something.
+ * 
+ * @param profile The counts.
+ * @param seconds The host time the counted run took.
+ * @param filename The file to write.
+ * @return true if the file was written.
+ */
+static bool WriteProfile(ProfileCounters const& profile, double seconds, std::string const& filename)
+{
+    std::ofstream file(filename);
+    if (!file) return false;
+
+    uint64_t instructions = 0;
+    for (auto const& count : profile.ops) instructions += count.load();
+    uint64_t frames = profile.frames.load();
+    double instructionsPerSecond = seconds > 0.0 ? static_cast<double>(instructions) / seconds : 0.0;
+    double framesPerSecond = seconds > 0.0 ? static_cast<double>(frames) / seconds : 0.0;
+
+    bool json = filename.size() >= 5 && filename.compare(filename.size() - 5, 5, ".json") == 0;
+    if (json)
+    {
+        file << "{\n  \"instructions\": " << instructions << ",\n  \"frames\": " << frames
+             << ",\n  \"seconds\": " << seconds << ",\n  \"instructionsPerSecond\": " << instructionsPerSecond
+             << ",\n  \"framesPerSecond\": " << framesPerSecond << ",\n  \"ops\": {";
+        for (size_t op = 0; op < OP_COUNT; ++op)
+        {
+            file << (op ? ", " : "") << "\"" << opNames[op] << "\": " << profile.ops[op].load();
+        }
+        file << "},\n  \"pcHits\": {";
+        bool first = true;
+        for (unsigned int address = 0; address < profile.addresses; ++address)
+        {
+            uint64_t hits = profile.pcHits[address].load();
+            if (hits == 0) continue;
+            file << (first ? "" : ", ") << "\"0x" << std::hex << std::setw(3) << std::setfill('0') << address << std::dec << "\": " << hits;
+            first = false;
+        }
+        file << "}\n}\n";
+    }
+    else
+    {
+        file << "kind,key,value\n";
+        file << "total,instructions," << instructions << "\n";
+        file << "total,frames," << frames << "\n";
+        file << "total,seconds," << seconds << "\n";
+        file << "total,instructionsPerSecond," << instructionsPerSecond << "\n";
+        file << "total,framesPerSecond," << framesPerSecond << "\n";
+        for (size_t op = 0; op < OP_COUNT; ++op)
+        {
+            file << "op," << opNames[op] << "," << profile.ops[op].load() << "\n";
+        }
+        for (unsigned int address = 0; address < profile.addresses; ++address)
+        {
+            uint64_t hits = profile.pcHits[address].load();
+            if (hits == 0) continue;
+            file << "pc,0x" << std::hex << std::setw(3) << std::setfill('0') << address << std::dec << "," << hits << "\n";
+        }
+    }
+
+    return static_cast<bool>(file);
+}
+
+/**
+ * @brief Runs many copies of a ROM on the batch engine and reports their combined throughput.
+ * 
+ * @param instances The number of machines.
+ * @param threads The number of threads, or 0 for every hardware thread.
+ * @param frames The number of frames each machine runs.
+ * @param instructionsPerFrame The number of instructions per frame.
+ * @param backend The interpreter backend.
+ * @param quirks The quirk profile.
+ * @param seed The random seed of the first machine, or null to seed randomly.
+ * @param romFilename The path to the ROM file.
+ * @return int Returns EXIT_SUCCESS on successful execution, or EXIT_FAILURE on error.
+ */
+static int RunBatch(size_t instances, unsigned int threads, uint64_t frames, unsigned int instructionsPerFrame,
+                    Backend backend, QuirkProfile quirks, uint32_t const* seed, std::string const& romFilename)
+{
+    Batch batch(instances, threads);
+    batch.SetQuirks(quirks);
+    batch.SetBackend(backend);
+    if (seed) batch.Seed(*seed);
+    if (!batch.LoadROM(romFilename))
+    {
+        std::cerr << "Failed to load ROM: " << romFilename << "\n";
+        return EXIT_FAILURE;
+    }
+
+    auto startTime = std::chrono::steady_clock::now();
+    batch.RunFrames(static_cast<unsigned int>(frames), instructionsPerFrame);
+    auto endTime = std::chrono::steady_clock::now();
+
+    double seconds = std::chrono::duration<double>(endTime - startTime).count();
+    uint64_t instructions = batch.InstructionCount();
+
+    std::cout << "instances: " << instances << "\n";
+    std::cout << "threads: " << batch.ThreadCount() << "\n";
+    std::cout << "instructions: " << instructions << "\n";
+    std::cout << "skipped idle cycles: " << batch.SkippedCycleCount() << "\n";
+    std::cout << "frames: " << frames << "\n";
+    std::cout << "wall time: " << seconds << " s\n";
+    std::cout << "instructions/s: " << (seconds > 0.0 ? static_cast<double>(instructions) / seconds : 0.0) << "\n";
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Runs many copies of a ROM in groups of LANES lockstep machines, the groups spread over a thread pool.
+ * 
+ * @param instances The number of machines, rounded up to whole groups.
+ * @param threads The number of threads, or 0 for every hardware thread.
+ * @param frames The number of frames each machine runs.
+ * @param instructionsPerFrame The number of instructions per frame.
+ * @param seed The random seed of the first machine, or null to seed randomly.
+ * @param romFilename The path to the ROM file.
+ * @return int Returns EXIT_SUCCESS on successful execution, or EXIT_FAILURE on error.
+ */
+template <size_t LANES>
+static int RunLockstep(size_t instances, unsigned int threads, uint64_t frames, unsigned int instructionsPerFrame,
+                       uint32_t const* seed, std::string const& romFilename)
+{
+    std::ifstream file(romFilename, std::ios::binary);
+    std::vector<uint8_t> rom((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    std::vector<Lockstep<LANES>> groups((instances + LANES - 1) / LANES);
+    for (size_t i = 0; i < groups.size(); ++i)
+    {
+        if (!file.is_open() || !groups[i].LoadROM(rom.data(), rom.size()))
+        {
+            std::cerr << "Failed to load ROM: " << romFilename << "\n";
+            return EXIT_FAILURE;
+        }
+
+        // Machines are numbered and seeded the way Batch::Seed() numbers them
+        for (size_t lane = 0; seed && lane < LANES; ++lane)
+        {
+            groups[i].Seed(lane, *seed + static_cast<uint32_t>(i * LANES + lane));
+        }
+    }
+
+    ThreadPool pool(threads);
+
+    auto startTime = std::chrono::steady_clock::now();
+    pool.ParallelFor(groups.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+        {
+            for (uint64_t frame = 0; frame < frames; ++frame)
+            {
+                groups[i].RunFrame(instructionsPerFrame);
+            }
+        }
+    });
+    auto endTime = std::chrono::steady_clock::now();
+
+    // Lanes never skip idle loops, so every lane-step was executed, in the vector group or on its own
+    double seconds = std::chrono::duration<double>(endTime - startTime).count();
+    uint64_t vectorSteps = 0;
+    uint64_t instructions = 0;
+    for (Lockstep<LANES> const& group : groups)
+    {
+        vectorSteps += group.VectorSteps();
+        instructions += group.VectorSteps() + group.ScalarSteps();
+    }
+
+    std::cout << "instances: " << groups.size() * LANES << " (" << groups.size() << " x " << LANES << " lanes)\n";
+    std::cout << "threads: " << pool.ThreadCount() << "\n";
+    std::cout << "instructions: " << instructions << "\n";
+    std::cout << "vectorized: " << (instructions > 0 ? 100.0 * static_cast<double>(vectorSteps) / static_cast<double>(instructions) : 0.0) << " %\n";
+    std::cout << "frames: " << frames << "\n";
+    std::cout << "wall time: " << seconds << " s\n";
+    std::cout << "instructions/s: " << (seconds > 0.0 ? static_cast<double>(instructions) / seconds : 0.0) << "\n";
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Entry point for the headless CHIP-8 runner.
+ *
+ * Loads a ROM and executes it at full host speed without SDL or frame pacing, then reports
+ * how many instructions ran, the wall time taken, and the resulting instructions per second.
+ *
+ * @param argc The number of command-line arguments.
+ * @param argv The array of command-line arguments.
+ * @return int Returns EXIT_SUCCESS on successful execution, or EXIT_FAILURE on error.
+ */
+int main(int argc, char** argv)
+{
+    uint64_t cycles = 0;
+    uint64_t frames = 0;
+    unsigned int instructionsPerFrame = DEFAULT_INSTRUCTIONS_PER_FRAME;
+    Backend backend = Backend::CHIP8_DEFAULT_BACKEND;
+    QuirkProfile quirks = QuirkProfile::Modern;
+    size_t instances = 1;
+    unsigned int threads = 0;
+    unsigned int lanes = 0;
+    uint32_t seed = 0;
+    bool seeded = false;
+    std::string movieFilename;
+    std::string profileFilename;
+    std::string traceFilename;
+    std::string debugSocket;
+    std::string romFilename;
+
+    // Parse command-line arguments
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--cycles") == 0 && i + 1 < argc)
+        {
+            cycles = std::stoull(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+        {
+            frames = std::stoull(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--ipf") == 0 && i + 1 < argc)
+        {
+            instructionsPerFrame = static_cast<unsigned int>(std::stoul(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--instances") == 0 && i + 1 < argc)
+        {
+            instances = std::stoull(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            threads = static_cast<unsigned int>(std::stoul(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--lanes") == 0 && i + 1 < argc)
+        {
+            lanes = static_cast<unsigned int>(std::stoul(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+        {
+            seed = static_cast<uint32_t>(std::stoul(argv[++i]));
+            seeded = true;
+        }
+        else if (std::strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+        {
+            movieFilename = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+        {
+            traceFilename = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--debug") == 0 && i + 1 < argc)
+        {
+            debugSocket = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--profile") == 0 && i + 1 < argc)
+        {
+            profileFilename = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--backend") == 0 && i + 1 < argc && ParseBackend(argv[i + 1], backend))
+        {
+            ++i;
+        }
+        else if (std::strcmp(argv[i], "--quirks") == 0 && i + 1 < argc && ParseQuirkProfile(argv[i + 1], quirks))
+        {
+            ++i;
+        }
+        else if (romFilename.empty() && argv[i][0] != '-')
+        {
+            romFilename = argv[i];
+        }
+        else
+        {
+            romFilename.clear();
+            break;
+        }
+    }
+
+    // Ensure correct usage; a movie brings its own quirk profile, and lockstep lanes implement the modern one only
+    bool replay = !movieFilename.empty();
+    bool quirked = quirks != QuirkProfile::Modern;
+    if (romFilename.empty() || (!replay && (cycles == 0) == (frames == 0)) || (replay && (cycles != 0 || frames != 0 || seeded || quirked))
+        || instructionsPerFrame == 0 || instances == 0 || ((instances > 1 || lanes != 0) && (frames == 0 || replay))
+        || (lanes != 0 && (quirked || (lanes != 8 && lanes != 16 && lanes != 32))) || ((!profileFilename.empty() || !traceFilename.empty() || !debugSocket.empty()) && (instances > 1 || lanes != 0)))
+    {
+        std::cerr << "Usage: " << argv[0] << " (--cycles <N> | --frames <N>) [--ipf <N>] [--seed <N>] [--backend table|switch|threaded|jit] [--quirks modern|vip|schip|xochip] [--profile <File.csv|File.json>] [--trace <File>] [--debug <Socket>] <ROM>\n";
+        std::cerr << "       " << argv[0] << " --replay <Movie> [--backend ...] [--profile <File>] [--trace <File>] [--debug <Socket>] <ROM>\n";
+        std::cerr << "       " << argv[0] << " --frames <N> --instances <N> [--threads <N>] [--lanes 8|16|32] [--ipf <N>] [--seed <N>] [--backend ...] [--quirks ...] <ROM>\n";
+        return EXIT_FAILURE;
+    }
+
+    switch (lanes)
+    {
+        case 8:  return RunLockstep<8>(instances, threads, frames, instructionsPerFrame, seeded ? &seed : nullptr, romFilename);
+        case 16: return RunLockstep<16>(instances, threads, frames, instructionsPerFrame, seeded ? &seed : nullptr, romFilename);
+        case 32: return RunLockstep<32>(instances, threads, frames, instructionsPerFrame, seeded ? &seed : nullptr, romFilename);
+        default: break;
+    }
+
+    if (!profileFilename.empty() && !Profiler::ENABLED)
+    {
+        std::cerr << "--profile needs a build configured with -DCHIP8_PROFILE=ON\n";
+        return EXIT_FAILURE;
+    }
+
+    if (instances > 1)
+    {
+        return RunBatch(instances, threads, frames, instructionsPerFrame, backend, quirks, seeded ? &seed : nullptr, romFilename);
+    }
+
+    // A replayed movie sets the seed, the speed, the quirk profile and the keypad of every frame
+    Movie movie;
+    if (replay)
+    {
+        if (!movie.Load(movieFilename))
+        {
+            std::cerr << "Failed to load movie: " << movieFilename << "\n";
+            return EXIT_FAILURE;
+        }
+        seed = movie.Seed();
+        seeded = true;
+        instructionsPerFrame = std::max(movie.InstructionsPerFrame(), 1u);
+        frames = movie.Frames();
+        quirks = movie.Quirks();
+    }
+
+    Chip8 chip8;
+    chip8.SetQuirks(quirks);
+    chip8.SetBackend(backend);
+    if (seeded) chip8.Seed(seed);
+    if (!chip8.LoadROM(romFilename))
+    {
+        std::cerr << "Failed to load ROM: " << romFilename << "\n";
+        return EXIT_FAILURE;
+    }
+
+    // Every instruction is recorded when asked, streamed to the file on a background thread
+    std::unique_ptr<TraceRing> traceRing;
+    std::unique_ptr<TraceWriter> traceWriter;
+    if (!traceFilename.empty())
+    {
+        traceRing = std::make_unique<TraceRing>();
+        traceWriter = std::make_unique<TraceWriter>(*traceRing);
+        if (!traceWriter->Open(traceFilename))
+        {
+            std::cerr << "Failed to write trace: " << traceFilename << "\n";
+            return EXIT_FAILURE;
+        }
+        chip8.SetTrace(traceRing.get());
+    }
+
+    // A debugged run waits for a client and stops before its first instruction
+    Debugger debugger(MemorySizeOf(chip8.GetQuirks()));
+    DebugServer debugServer(debugger);
+    if (!debugSocket.empty())
+    {
+        if (!debugServer.Open(debugSocket))
+        {
+            std::cerr << "Failed to open debug socket: " << debugSocket << "\n";
+            return EXIT_FAILURE;
+        }
+        chip8.SetDebugger(&debugger);
+        std::cerr << "Waiting for a debugger on " << debugSocket << "\n";
+        debugServer.WaitForClient();
+        debugger.Pause();
+    }
+
+    // Run the core flat out in whole frames, then any leftover cycles
+    uint64_t remainder = 0;
+    if (frames != 0)
+    {
+        cycles = frames * instructionsPerFrame;
+    }
+    else
+    {
+        frames = cycles / instructionsPerFrame;
+        remainder = cycles % instructionsPerFrame;
+    }
+
+    auto startTime = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < frames; ++i)
+    {
+        if (replay) movie.Play(chip8.keypad);
+        chip8.RunFrame(instructionsPerFrame);
+    }
+    chip8.Run(static_cast<unsigned int>(remainder));
+    auto endTime = std::chrono::steady_clock::now();
+
+    double seconds = std::chrono::duration<double>(endTime - startTime).count();
+
+    if (traceWriter && !traceWriter->Close())
+    {
+        std::cerr << "Failed to write trace: " << traceFilename << "\n";
+        return EXIT_FAILURE;
+    }
+
+    // Hash of the final machine state, to check that runs with the same seed and input match
+    SaveStateBuffer state;
+    chip8.SaveState(state.data(), state.size());
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < chip8.SaveStateSize(); ++i)
+    {
+        hash = (hash ^ state[i]) * 1099511628211ull;
+    }
+
+    std::cout << "instructions: " << chip8.InstructionCount() << "\n";
+    std::cout << "skipped idle cycles: " << chip8.SkippedCycleCount() << "\n";
+    std::cout << "frames: " << frames << "\n";
+    std::cout << "wall time: " << seconds << " s\n";
+    std::cout << "instructions/s: " << (seconds > 0.0 ? static_cast<double>(chip8.InstructionCount()) / seconds : 0.0) << "\n";
+    std::cout << "state hash: " << std::hex << std::setw(16) << std::setfill('0') << hash << std::dec << "\n";
+
+    if (Profiler::ENABLED && !profileFilename.empty() && !WriteProfile(*chip8.Profile(), seconds, profileFilename))
+    {
+        std::cerr << "Failed to write profile: " << profileFilename << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
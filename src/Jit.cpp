@@ -0,0 +1,425 @@
+#include "../include/Jit.hpp"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__linux__) || defined(__APPLE__))
+#define CHIP8_JIT_AVAILABLE 1
+#include <sys/mman.h>
+#endif
+
+constexpr int32_t UNCOMPILED = -1;  // blockAt entry: not translated yet
+constexpr int32_t NO_BLOCK   = -2;  // blockAt entry: translation failed, interpret instead
+
+// Worst-case code size of one block, so a translation never runs off the end of the arena
+constexpr size_t MAX_BLOCK_CODE_SIZE = 64 + JIT_MAX_BLOCK_LENGTH * 64;
+
+namespace
+{
+	/**
+	 * @brief Appends x86-64 machine code to a buffer.
+	 *
+	 * Chip8 state is addressed relative to rbx, which holds the Chip8 pointer for the whole block.
+	 * r12d holds the remaining cycle budget.
+	 */
+	class Emitter
+	{
+	public:
+		explicit Emitter(uint8_t* code) : code(code) {}
+
+		uint8_t* Position() const { return code + size; }
+
+		void Byte(uint8_t b) { code[size++] = b; }
+		void Bytes(std::initializer_list<uint8_t> bytes) { for (uint8_t b : bytes) Byte(b); }
+		void Imm16(uint16_t v) { std::memcpy(code + size, &v, 2); size += 2; }
+		void Imm32(uint32_t v) { std::memcpy(code + size, &v, 4); size += 4; }
+		void Imm64(uint64_t v) { std::memcpy(code + size, &v, 8); size += 8; }
+
+		// <op> with a [rbx + disp32] memory operand; reg is the ModRM reg field (register or /digit)
+		void RbxOperand(std::initializer_list<uint8_t> op, uint8_t reg, int32_t disp)
+		{
+			Bytes(op);
+			Byte(0x80 | (reg << 3) | 0x3);
+			Imm32(static_cast<uint32_t>(disp));
+		}
+
+		// mov word [rbx + disp], imm16
+		void StoreWord(int32_t disp, uint16_t value) { RbxOperand({0x66, 0xC7}, 0, disp); Imm16(value); }
+
+		// jmp rel32 to an absolute position in the buffer
+		void Jump(uint8_t const* target)
+		{
+			Byte(0xE9);
+			Imm32(static_cast<uint32_t>(target - (Position() + 4)));
+		}
+
+		size_t size{};
+
+	private:
+		uint8_t* code;
+	};
+}
+
+/**
+ * @brief Calls an interpreter handler on behalf of translated code.
+ */
+void Jit::CallHandler(Chip8* chip8, Instruction const* in)
+{
+	chip8->Execute(*in);
+}
+
+/**
+ * @brief Reserves the executable arena and marks every address as untranslated.
+ */
+Jit::Jit()
+{
+	blockAt.fill(UNCOMPILED);
+
+#ifdef CHIP8_JIT_AVAILABLE
+	void* memory = mmap(nullptr, JIT_ARENA_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (memory != MAP_FAILED) arena = static_cast<uint8_t*>(memory);
+#endif
+}
+
+/**
+ * @brief Releases the executable arena.
+ */
+Jit::~Jit()
+{
+#ifdef CHIP8_JIT_AVAILABLE
+	if (arena) munmap(arena, JIT_ARENA_SIZE);
+#endif
+}
+
+/**
+ * @brief Returns true if this host can run translated code.
+ */
+bool Jit::Supported()
+{
+#ifdef CHIP8_JIT_AVAILABLE
+	return true;
+#else
+	return false;
+#endif
+}
+
+/**
+ * @brief Executes a number of CPU cycles, translating blocks as they are reached.
+ *
+ * Blocks check the budget before every instruction, so the cycle count is exact
+ * and matches the interpreter backends instruction for instruction.
+ *
+ * @param chip8 The machine to run.
+ * @param cycles The number of instructions to execute.
+ * @return The cycles not executed: those an idle-loop skip ran off, or the rest once Fx0A halts.
+ */
+unsigned int Jit::Run(Chip8& chip8, unsigned int cycles)
+{
+	while (cycles > 0)
+	{
+		uint16_t pc = chip8.pc;
+		int32_t block = (pc >= START_ADDRESS && pc < CODE_SPACE - 1) ? blockAt[pc] : NO_BLOCK;
+
+		if (block == UNCOMPILED)
+		{
+			block = Compile(chip8, pc);
+			blockAt[pc] = block;
+		}
+
+		if (block >= 0)
+		{
+			cycles = blocks[block].entry(&chip8, cycles);
+		}
+		else
+		{
+			chip8.Cycle();
+			--cycles;
+		}
+		// Fx0A ends every block, so a halt is seen right after the block that hit it
+		if (chip8.waitingForKey) return cycles;
+
+		// Blocks end at jumps, so an idle loop is seen as soon as pc enters it
+		if (chip8.SkipIdleLoop(cycles)) return cycles;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Drops translated blocks overlapping a range of memory that was just written.
+ *
+ * Only the lookup entries are cleared; the code itself is reclaimed on the next flush, so a block
+ * that writes over itself can still return normally.
+ *
+ * @param address The first address written.
+ * @param length The number of bytes written.
+ */
+void Jit::Invalidate(Chip8 const&, unsigned int address, unsigned int length)
+{
+	if (length == 0) return;
+
+	unsigned int end = address + length;
+
+	// Only the pages written can hold blocks built from these bytes
+	const unsigned int firstPage = std::min(address, CODE_SPACE - 1) / JIT_PAGE_SIZE;
+	const unsigned int lastPage = std::min(end - 1, CODE_SPACE - 1) / JIT_PAGE_SIZE;
+
+	for (unsigned int page = firstPage; page <= lastPage; ++page)
+	{
+		std::vector<int32_t>& live = pageBlocks[page];
+		live.erase(std::remove_if(live.begin(), live.end(), [&](int32_t index) {
+			Block const& block = blocks[index];
+			if (blockAt[block.start] != index) return true;  // Already dropped through another page
+			if (address >= block.end || end <= block.start) return false;
+			blockAt[block.start] = UNCOMPILED;
+			return true;
+		}), live.end());
+	}
+
+	// Addresses that failed to translate may translate now
+	for (unsigned int a = std::max(address, 1u) - 1; a < std::min(end, CODE_SPACE); ++a)
+	{
+		if (blockAt[a] == NO_BLOCK) blockAt[a] = UNCOMPILED;
+	}
+}
+
+/**
+ * @brief Throws away every translated block.
+ */
+void Jit::Flush()
+{
+	blocks.clear();
+	callbacks.clear();
+	blockAt.fill(UNCOMPILED);
+	for (std::vector<int32_t>& live : pageBlocks) live.clear();
+	arenaUsed = 0;
+}
+
+/**
+ * @brief Translates the block starting at an address into x86-64 code.
+ *
+ * Emitted code follows the System V ABI: rdi = Chip8*, esi = cycle budget, eax = budget left.
+ * Every instruction is preceded by a budget check that stores its address to pc and exits when
+ * the budget is spent. Instructions that change pc or write memory end the block.
+ *
+ * @param chip8 The machine whose memory holds the code.
+ * @param address The address of the first instruction.
+ * @return The index of the new block, or NO_BLOCK if it could not be translated.
+ */
+int32_t Jit::Compile(Chip8 const& chip8, uint16_t address)
+{
+#ifdef CHIP8_JIT_AVAILABLE
+	if (!arena) return NO_BLOCK;
+
+	if (arenaUsed + MAX_BLOCK_CODE_SIZE > JIT_ARENA_SIZE) Flush();
+	if (mprotect(arena, JIT_ARENA_SIZE, PROT_READ | PROT_WRITE) != 0) return NO_BLOCK;
+
+	// Offsets of Chip8 state from the object's address, which rbx holds
+	auto offsetOf = [&chip8](void const* member) {
+		return static_cast<int32_t>(reinterpret_cast<uint8_t const*>(member) - reinterpret_cast<uint8_t const*>(&chip8));
+	};
+	const int32_t regs = offsetOf(chip8.registers.data());
+	const int32_t vf = regs + 0xF;
+	const int32_t pcOffset = offsetOf(&chip8.pc);
+	const int32_t spOffset = offsetOf(&chip8.sp);
+	const int32_t stackOffset = offsetOf(chip8.stack.data());
+
+	// The machine's quirks are baked into the code; changing them flushes every block
+	const Quirks quirks = QuirksOf(chip8.quirkProfile);
+
+	Emitter e(arena + arenaUsed);
+
+	// Shared exit, placed first so every jump to it is a known backward displacement:
+	// mov eax, r12d; pop r13; pop r12; pop rbx; ret
+	uint8_t const* exit = e.Position();
+	e.Bytes({0x44, 0x89, 0xE0, 0x41, 0x5D, 0x41, 0x5C, 0x5B, 0xC3});
+
+	// Entry: push rbx; push r12; push r13 (keeps rsp 16-byte aligned for calls); mov rbx, rdi; mov r12d, esi
+	uint8_t* entry = e.Position();
+	e.Bytes({0x53, 0x41, 0x54, 0x41, 0x55, 0x48, 0x89, 0xFB, 0x41, 0x89, 0xF4});
+
+	uint16_t a = address;
+	bool ended = false;
+
+	// One past the last byte the block depends on: past the last instruction, or past a word read ahead
+	uint16_t end = address;
+
+	for (unsigned int count = 0; count < JIT_MAX_BLOCK_LENGTH && !ended && a < CODE_SPACE - 1; ++count, a += 2)
+	{
+		Instruction in = chip8.Decode(a);
+		const uint16_t next = a + 2;
+		const int32_t vx = regs + in.x;
+		const int32_t vy = regs + in.y;
+
+		// test r12d, r12d; jnz over the exit; mov word [pc], a; jmp exit; dec r12d
+		e.Bytes({0x45, 0x85, 0xE4, 0x75, 0x0E});
+		e.StoreWord(pcOffset, a);
+		e.Jump(exit);
+		e.Bytes({0x41, 0xFF, 0xCC});
+
+		// Conditional pc update for skips, with the condition already in the flags:
+		// mov eax, next; mov ecx, skipped; cmov<cc> eax, ecx; mov [pc], ax
+		// XO-CHIP skips step over all of an F000 NNNN, so the next instruction becomes part of the block.
+		auto skipIf = [&](uint8_t cmov) {
+			const bool longNext = quirks.xoChip && chip8.Memory()[next] == 0xF0 && chip8.Memory()[next + 1] == 0x00;
+			if (quirks.xoChip) end = static_cast<uint16_t>(next + 2);
+			e.Byte(0xB8); e.Imm32(next);
+			e.Byte(0xB9); e.Imm32(next + (longNext ? 4u : 2u));
+			e.Bytes({0x0F, cmov, 0xC1});
+			e.RbxOperand({0x66, 0x89}, 0, pcOffset);
+			ended = true;
+		};
+
+		switch (in.op)
+		{
+			case Op::OP_NULL:
+				break;
+
+			case Op::OP_6xkk:
+				e.RbxOperand({0xC6}, 0, vx); e.Byte(in.kk);                // mov byte [Vx], kk
+				break;
+
+			case Op::OP_7xkk:
+				e.RbxOperand({0x80}, 0, vx); e.Byte(in.kk);                // add byte [Vx], kk
+				break;
+
+			case Op::OP_8xy0:
+				e.RbxOperand({0x8A}, 0, vy);                                // mov al, [Vy]
+				e.RbxOperand({0x88}, 0, vx);                                // mov [Vx], al
+				break;
+
+			case Op::OP_8xy1:
+			case Op::OP_8xy2:
+			case Op::OP_8xy3:
+				e.RbxOperand({0x8A}, 0, vy);                                // mov al, [Vy]
+				e.RbxOperand({in.op == Op::OP_8xy1 ? uint8_t{0x08}          // or/and/xor [Vx], al
+				             : in.op == Op::OP_8xy2 ? uint8_t{0x20} : uint8_t{0x30}}, 0, vx);
+				if (quirks.resetVF)
+				{
+					e.RbxOperand({0xC6}, 0, vf); e.Byte(0);                 // mov byte [VF], 0
+				}
+				break;
+
+			case Op::OP_8xy4:
+				e.RbxOperand({0x8A}, 0, vx);                                // mov al, [Vx]
+				e.RbxOperand({0x02}, 0, vy);                                // add al, [Vy]
+				e.Bytes({0x0F, 0x92, 0xC1});                                // setc cl
+				e.RbxOperand({0x88}, 1, vf);                                // mov [VF], cl
+				e.RbxOperand({0x88}, 0, vx);                                // mov [Vx], al
+				break;
+
+			case Op::OP_8xy5:
+			case Op::OP_8xy7:
+			{
+				// VF is written before the subtraction reads its operands, as in the interpreter
+				const int32_t lhs = in.op == Op::OP_8xy5 ? vx : vy;
+				const int32_t rhs = in.op == Op::OP_8xy5 ? vy : vx;
+				e.RbxOperand({0x8A}, 0, lhs);                               // mov al, [lhs]
+				e.RbxOperand({0x3A}, 0, rhs);                               // cmp al, [rhs]
+				e.Bytes({0x0F, 0x97, 0xC1});                                // seta cl
+				e.RbxOperand({0x88}, 1, vf);                                // mov [VF], cl
+				e.RbxOperand({0x8A}, 0, lhs);                               // mov al, [lhs]
+				e.RbxOperand({0x2A}, 0, rhs);                               // sub al, [rhs]
+				e.RbxOperand({0x88}, 0, vx);                                // mov [Vx], al
+				break;
+			}
+
+			case Op::OP_8xy6:
+			case Op::OP_8xyE:
+			{
+				const bool right = in.op == Op::OP_8xy6;
+				if (quirks.shiftVy)
+				{
+					// Vy shifted into Vx, VF written last
+					e.RbxOperand({0x8A}, 0, vy);                            // mov al, [Vy]
+					e.Bytes({0x88, 0xC1});                                  // mov cl, al
+					e.Bytes({0xD0, static_cast<uint8_t>(right ? 0xE9 : 0xE1)});   // shr/shl cl, 1
+					e.RbxOperand({0x88}, 1, vx);                            // mov [Vx], cl
+					if (right) e.Bytes({0x24, 0x01});                       // and al, 1
+					else e.Bytes({0xC0, 0xE8, 0x07});                       // shr al, 7
+					e.RbxOperand({0x88}, 0, vf);                            // mov [VF], al
+				}
+				else
+				{
+					e.RbxOperand({0x8A}, 0, vx);                            // mov al, [Vx]
+					if (right) e.Bytes({0x24, 0x01});                       // and al, 1
+					else e.Bytes({0xC0, 0xE8, 0x07});                       // shr al, 7
+					e.RbxOperand({0x88}, 0, vf);                            // mov [VF], al
+					e.RbxOperand({0xD0}, right ? 5 : 4, vx);                // shr/shl byte [Vx], 1
+				}
+				break;
+			}
+
+			case Op::OP_3xkk:
+			case Op::OP_4xkk:
+				e.RbxOperand({0x80}, 7, vx); e.Byte(in.kk);                // cmp byte [Vx], kk
+				skipIf(in.op == Op::OP_3xkk ? 0x44 : 0x45);                 // cmove / cmovne
+				break;
+
+			case Op::OP_5xy0:
+			case Op::OP_9xy0:
+				e.RbxOperand({0x8A}, 0, vx);                                // mov al, [Vx]
+				e.RbxOperand({0x3A}, 0, vy);                                // cmp al, [Vy]
+				skipIf(in.op == Op::OP_5xy0 ? 0x44 : 0x45);                 // cmove / cmovne
+				break;
+
+			case Op::OP_1nnn:
+				e.StoreWord(pcOffset, in.nnn);                              // mov word [pc], nnn
+				ended = true;
+				break;
+
+			case Op::OP_2nnn:
+				e.RbxOperand({0x0F, 0xB6}, 0, spOffset);                    // movzx eax, byte [sp]
+				e.Bytes({0x83, 0xE0, uint8_t{STACK_LEVELS - 1}});           // and eax, STACK_LEVELS - 1
+				e.Bytes({0x66, 0xC7, 0x84, 0x43});                          // mov word [rbx + rax*2 + stack], next
+				e.Imm32(static_cast<uint32_t>(stackOffset)); e.Imm16(next);
+				e.RbxOperand({0xFE}, 0, spOffset);                          // inc byte [sp]
+				e.StoreWord(pcOffset, in.nnn);                              // mov word [pc], nnn
+				ended = true;
+				break;
+
+			default:
+			{
+				// Everything else runs through the interpreter's handler. Handlers that may change pc or
+				// write memory see pc already advanced, as in Cycle(), and end the block.
+				switch (in.op)
+				{
+					case Op::OP_00EE: case Op::OP_Bnnn: case Op::OP_Ex9E: case Op::OP_ExA1:
+					case Op::OP_Fx0A: case Op::OP_Fx33: case Op::OP_Fx55: case Op::OP_00FD:
+					case Op::OP_5xy2: case Op::OP_5xy3: case Op::OP_F000:
+						e.StoreWord(pcOffset, next);
+						ended = true;
+						break;
+					default:
+						break;
+				}
+
+				callbacks.push_back(in);
+				e.Bytes({0x48, 0x89, 0xDF});                                // mov rdi, rbx
+				e.Bytes({0x48, 0xBE}); e.Imm64(reinterpret_cast<uint64_t>(&callbacks.back()));     // mov rsi, imm64
+				e.Bytes({0x48, 0xB8}); e.Imm64(reinterpret_cast<uint64_t>(&CallHandler));          // mov rax, imm64
+				e.Bytes({0xFF, 0xD0});                                      // call rax
+				break;
+			}
+		}
+	}
+
+	// Fell off the end of the block without a jump: continue at the next instruction
+	if (!ended) e.StoreWord(pcOffset, a);
+	e.Jump(exit);
+
+	arenaUsed += (e.size + 15) & ~size_t{15};
+	if (mprotect(arena, JIT_ARENA_SIZE, PROT_READ | PROT_EXEC) != 0) return NO_BLOCK;
+
+	blocks.push_back(Block{reinterpret_cast<BlockFunc>(entry), address, std::max(a, end)});
+	const int32_t index = static_cast<int32_t>(blocks.size() - 1);
+
+	const unsigned int lastPage = std::min<unsigned int>(blocks.back().end - 1, CODE_SPACE - 1) / JIT_PAGE_SIZE;
+	for (unsigned int page = address / JIT_PAGE_SIZE; page <= lastPage; ++page) pageBlocks[page].push_back(index);
+
+	return index;
+#else
+	(void)chip8;
+	(void)address;
+	return NO_BLOCK;
+#endif
+}
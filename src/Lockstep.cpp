@@ -0,0 +1,548 @@
+#include "../include/Lockstep.hpp"
+#include <algorithm>
+#include <cstring>
+#include <random>
+
+namespace
+{
+	/**
+	 * @brief Returns true if every lane of a comparison mask is set.
+	 */
+	template <typename M>
+	bool AllSet(M const& mask)
+	{
+		uint64_t words[sizeof(M) / sizeof(uint64_t)];
+		std::memcpy(words, &mask, sizeof(M));
+
+		uint64_t all = ~uint64_t{0};
+		for (uint64_t word : words) all &= word;
+		return all == ~uint64_t{0};
+	}
+
+	/**
+	 * @brief Overwrites the lanes of a vector where the mask is set. Vectors are passed by reference
+	 * so the calling convention does not depend on whether AVX is enabled.
+	 */
+	template <typename V, typename M>
+	void Merge(V& target, M const& mask, V const& value)
+	{
+		target = (reinterpret_cast<V const&>(mask) & value) | (~reinterpret_cast<V const&>(mask) & target);
+	}
+}
+
+/**
+ * @brief Constructs every lane in the state of a freshly constructed Chip8.
+ */
+template <size_t LANES>
+Lockstep<LANES>::Lockstep()
+{
+	pc = U16{} + static_cast<uint16_t>(START_ADDRESS);
+
+	std::random_device seeder;
+	for (size_t lane = 0; lane < LANES; ++lane)
+	{
+		random[lane].Seed(seeder());
+	}
+
+	for (unsigned int i = 0; i < FONTSET_SIZE; ++i)
+	{
+		memory[FONTSET_START_ADDRESS + i] = U8{} + fontset[i];
+	}
+	for (unsigned int i = 0; i < BIGFONT_SIZE; ++i)
+	{
+		memory[BIGFONT_START_ADDRESS + i] = U8{} + bigFontset[i];
+	}
+}
+
+/**
+ * @brief Loads a ROM image into every lane.
+ *
+ * @param data The ROM bytes.
+ * @param size The number of bytes.
+ * @return true if the ROM fits in program memory.
+ */
+template <size_t LANES>
+bool Lockstep<LANES>::LoadROM(uint8_t const* data, size_t size)
+{
+	if (size > MEMORY_SIZE - START_ADDRESS) return false;
+
+	for (size_t i = 0; i < size; ++i)
+	{
+		memory[START_ADDRESS + i] = U8{} + data[i];
+	}
+	NoteWrite(START_ADDRESS, MEMORY_SIZE - START_ADDRESS);
+	return true;
+}
+
+/**
+ * @brief Executes a number of CPU cycles on every lane.
+ *
+ * @param cycles The number of instructions each lane executes.
+ */
+template <size_t LANES>
+void Lockstep<LANES>::Run(unsigned int cycles)
+{
+	for (unsigned int i = 0; i < cycles; ++i)
+	{
+		Step();
+	}
+}
+
+/**
+ * @brief Executes one 60 Hz frame on every lane: a fixed number of CPU cycles followed by one timer tick.
+ *
+ * @param instructionsPerFrame The number of instructions to execute in the frame.
+ */
+template <size_t LANES>
+void Lockstep<LANES>::RunFrame(unsigned int instructionsPerFrame)
+{
+	Run(instructionsPerFrame);
+	TickTimers();
+}
+
+/**
+ * @brief Decrements every lane's delay and sound timers, stopping at zero.
+ */
+template <size_t LANES>
+void Lockstep<LANES>::TickTimers()
+{
+	// A true comparison is all ones, so adding it subtracts one from the nonzero timers
+	delayTimer += reinterpret_cast<U8>(delayTimer != 0);
+	soundTimer += reinterpret_cast<U8>(soundTimer != 0);
+}
+
+/**
+ * @brief Returns one lane's framebuffer.
+ *
+ * @param lane The lane.
+ */
+template <size_t LANES>
+VideoBuffer Lockstep<LANES>::Video(size_t lane) const
+{
+	VideoBuffer out;
+	for (unsigned int row = 0; row < VIDEO_HEIGHT; ++row)
+	{
+		out.planes[0][row] = video[row][lane];
+	}
+	return out;
+}
+
+/**
+ * @brief Executes one instruction on every lane.
+ *
+ * When all lanes share a pc (the common case) the group is found with one vector compare.
+ * Otherwise the pc held by the most lanes leads, and where lanes' memory differs at that pc,
+ * lanes holding a different opcode there also drop out to the scalar path.
+ */
+template <size_t LANES>
+void Lockstep<LANES>::Step()
+{
+	uint16_t leader = pc[0];
+	M16 mask16 = pc == leader;
+
+	// Every lane together on code they all hold the same bytes of: one vector step, no per-lane work
+	if (AllSet(mask16) && !divergent[leader & (MEMORY_SIZE - 1)] && !divergent[(leader + 1) & (MEMORY_SIZE - 1)])
+	{
+		StepVector(leader, OpcodeAt(0, leader), ~M8{}, mask16, 0);
+		vectorSteps += LANES;
+		return;
+	}
+
+	leader = MajorityPc();
+	mask16 = pc == leader;
+
+	size_t first = 0;
+	while (!mask16[first]) ++first;
+
+	const uint16_t opcode = OpcodeAt(first, leader);
+	if (divergent[leader & (MEMORY_SIZE - 1)] || divergent[(leader + 1) & (MEMORY_SIZE - 1)])
+	{
+		for (size_t lane = first + 1; lane < LANES; ++lane)
+		{
+			if (mask16[lane] && OpcodeAt(lane, leader) != opcode) mask16[lane] = 0;
+		}
+	}
+
+	StepVector(leader, opcode, __builtin_convertvector(mask16, M8), mask16, first);
+
+	unsigned int scalar = 0;
+	for (size_t lane = 0; lane < LANES; ++lane)
+	{
+		if (!mask16[lane])
+		{
+			StepLane(lane);
+			++scalar;
+		}
+	}
+
+	vectorSteps += LANES - scalar;
+	scalarSteps += scalar;
+}
+
+/**
+ * @brief Executes an instruction on the lanes in a mask, all of them at the same pc.
+ *
+ * Stack, memory, key and drawing instructions are vectorized when the lanes agree on the
+ * per-lane index involved (sp, I, the key register, the sprite row), which they usually do
+ * when running the same ROM. Otherwise, and for Cxkk and Fx0A, they run lane by lane.
+ *
+ * @param address The pc shared by the lanes.
+ * @param opcode The instruction at that address.
+ * @param mask8 The lanes to execute, as a byte mask.
+ * @param mask16 The same lanes, as a 16-bit mask.
+ * @param first The lowest lane in the mask.
+ */
+template <size_t LANES>
+void Lockstep<LANES>::StepVector(uint16_t address, uint16_t opcode, M8 const& mask8, M16 const& mask16, size_t first)
+{
+	const unsigned int x = (opcode & 0x0F00u) >> 8u;
+	const unsigned int y = (opcode & 0x00F0u) >> 4u;
+	const unsigned int n = opcode & 0x000Fu;
+	const uint8_t kk = opcode & 0x00FFu;
+	const uint16_t nnn = opcode & 0x0FFFu;
+	const U16 next = U16{} + static_cast<uint16_t>(address + 2);
+	const U16 skip = U16{} + static_cast<uint16_t>(address + 4);
+
+	U8& Vx = registers[x];
+	U8& VF = registers[0xF];
+	const U8 a = registers[x];
+	const U8 b = registers[y];
+
+	// True if every lane in the mask holds the same value
+	auto uniform8 = [&](U8 const& v) { return AllSet((v == v[first]) | ~mask8); };
+	auto uniform16 = [&](U16 const& v) { return AllSet((v == v[first]) | ~mask16); };
+
+	auto perLane = [&] {
+		for (size_t lane = first; lane < LANES; ++lane)
+		{
+			if (mask8[lane]) ExecuteLane(lane, opcode);
+		}
+	};
+
+	auto skipIf = [&](M8 const& condition) {
+		Merge(pc, __builtin_convertvector(condition & mask8, M16), skip);
+	};
+
+	// The interpreter assigns VF first and then reads Vx and Vy again, so the result is computed
+	// after this; with x or y == F it takes the flag as its operand
+	auto setFlag = [&](U8 const& flag) { Merge(VF, mask8, flag); };
+
+	Merge(pc, mask16, next);
+
+	// Decoded like the interpreter, so unused encodings (0nn0, ExnE, ...) behave the same. The SUPER-CHIP
+	// and XO-CHIP instructions do nothing on the modern profile, except 5xy2 and 5xy3, which compare like 5xy0.
+	switch (Decode(opcode))
+	{
+		case Op::OP_00E0:
+		{
+			const M64 mask64 = __builtin_convertvector(mask8, M64);
+			for (U64& row : video) Merge(row, mask64, U64{});
+			break;
+		}
+		case Op::OP_00EE:
+			if (uniform8(sp))
+			{
+				const unsigned int level = (sp[first] - 1u) & (STACK_LEVELS - 1);
+				Merge(sp, mask8, sp - 1);
+				Merge(pc, mask16, stack[level]);
+			}
+			else
+			{
+				perLane();
+			}
+			break;
+		case Op::OP_1nnn: Merge(pc, mask16, U16{} + nnn); break;
+		case Op::OP_2nnn:
+			if (uniform8(sp))
+			{
+				Merge(stack[sp[first] & (STACK_LEVELS - 1)], mask16, next);
+				Merge(sp, mask8, sp + 1);
+				Merge(pc, mask16, U16{} + nnn);
+			}
+			else
+			{
+				perLane();
+			}
+			break;
+		case Op::OP_3xkk: skipIf(a == kk); break;
+		case Op::OP_4xkk: skipIf(a != kk); break;
+		case Op::OP_5xy0:
+		case Op::OP_5xy2:
+		case Op::OP_5xy3: skipIf(a == b); break;
+		case Op::OP_6xkk: Merge(Vx, mask8, U8{} + kk); break;
+		case Op::OP_7xkk: Merge(Vx, mask8, a + kk); break;
+		case Op::OP_8xy0: Merge(Vx, mask8, b); break;
+		case Op::OP_8xy1: Merge(Vx, mask8, a | b); break;
+		case Op::OP_8xy2: Merge(Vx, mask8, a & b); break;
+		case Op::OP_8xy3: Merge(Vx, mask8, a ^ b); break;
+		case Op::OP_8xy4: setFlag(reinterpret_cast<U8>(static_cast<U8>(a + b) < a) & 1); Merge(Vx, mask8, a + b); break;
+		case Op::OP_8xy5: setFlag(reinterpret_cast<U8>(a > b) & 1); Merge(Vx, mask8, Vx - registers[y]); break;
+		case Op::OP_8xy6: setFlag(a & 1); Merge(Vx, mask8, Vx >> 1); break;
+		case Op::OP_8xy7: setFlag(reinterpret_cast<U8>(b > a) & 1); Merge(Vx, mask8, registers[y] - Vx); break;
+		case Op::OP_8xyE: setFlag(a >> 7); Merge(Vx, mask8, Vx << 1); break;
+		case Op::OP_9xy0: skipIf(a != b); break;
+		case Op::OP_Annn: Merge(index, mask16, U16{} + nnn); break;
+		case Op::OP_Bnnn: Merge(pc, mask16, __builtin_convertvector(registers[0], U16) + nnn); break;
+		case Op::OP_Dxyn:
+			if (uniform16(index) && uniform8(b))
+			{
+				// Rows and sprite bytes are shared; each lane shifts by its own x
+				const uint16_t I = index[first];
+				const unsigned int yPos = b[first] % VIDEO_HEIGHT;
+				const unsigned int rows = std::min<unsigned int>(n, VIDEO_HEIGHT - yPos);
+				const M64 mask64 = __builtin_convertvector(mask8, M64);
+				const U64 xPos = __builtin_convertvector(a % VIDEO_WIDTH, U64);
+				U64 collision{};
+
+				for (unsigned int row = 0; row < rows; ++row)
+				{
+					U64 spriteRow = ((__builtin_convertvector(memory[(I + row) & (MEMORY_SIZE - 1)], U64) << 56u) >> xPos)
+						& reinterpret_cast<U64 const&>(mask64);
+					collision |= video[yPos + row] & spriteRow;
+					video[yPos + row] ^= spriteRow;
+				}
+
+				Merge(VF, mask8, reinterpret_cast<U8>(__builtin_convertvector(collision != 0, M8)) & 1);
+			}
+			else
+			{
+				perLane();
+			}
+			break;
+		case Op::OP_Ex9E:
+		case Op::OP_ExA1:
+			if (uniform8(a))
+			{
+				const U8& key = keypad[a[first] & (KEY_COUNT - 1)];
+				skipIf(n == 0xE ? key != 0 : key == 0);
+			}
+			else
+			{
+				perLane();
+			}
+			break;
+		case Op::OP_Fx07: Merge(Vx, mask8, delayTimer); break;
+		case Op::OP_Fx15: Merge(delayTimer, mask8, a); break;
+		case Op::OP_Fx18: Merge(soundTimer, mask8, a); break;
+		case Op::OP_Fx1E: Merge(index, mask16, index + __builtin_convertvector(a, U16)); break;
+		case Op::OP_Fx29:
+			Merge(index, mask16, static_cast<uint16_t>(FONTSET_START_ADDRESS) + 5 * __builtin_convertvector(a, U16));
+			break;
+		case Op::OP_Fx33:
+			if (uniform16(index))
+			{
+				const uint16_t I = index[first];
+				Merge(memory[(I + 2) & (MEMORY_SIZE - 1)], mask8, a % 10);
+				Merge(memory[(I + 1) & (MEMORY_SIZE - 1)], mask8, (a / 10) % 10);
+				Merge(memory[I & (MEMORY_SIZE - 1)], mask8, (a / 100) % 10);
+				NoteWrite(I, 3);
+			}
+			else
+			{
+				perLane();
+			}
+			break;
+		case Op::OP_Fx55:
+			if (uniform16(index))
+			{
+				const uint16_t I = index[first];
+				for (unsigned int r = 0; r <= x; ++r)
+				{
+					Merge(memory[(I + r) & (MEMORY_SIZE - 1)], mask8, registers[r]);
+				}
+				NoteWrite(I, x + 1);
+			}
+			else
+			{
+				perLane();
+			}
+			break;
+		case Op::OP_Fx65:
+			if (uniform16(index))
+			{
+				const uint16_t I = index[first];
+				for (unsigned int r = 0; r <= x; ++r)
+				{
+					Merge(registers[r], mask8, memory[(I + r) & (MEMORY_SIZE - 1)]);
+				}
+			}
+			else
+			{
+				perLane();
+			}
+			break;
+		case Op::OP_Cxkk:
+		case Op::OP_Fx0A:
+			// Cxkk: each lane draws from its own generator
+			perLane();
+			break;
+		default: break;
+	}
+}
+
+/**
+ * @brief Fetches and executes one instruction on a single lane.
+ *
+ * @param lane The lane.
+ */
+template <size_t LANES>
+void Lockstep<LANES>::StepLane(size_t lane)
+{
+	const uint16_t address = pc[lane];
+	pc[lane] = address + 2;
+	ExecuteLane(lane, OpcodeAt(lane, address));
+}
+
+/**
+ * @brief Executes an instruction on a single lane whose pc has already been advanced past it.
+ *
+ * Mirrors the modern-profile Chip8 handlers, with stack, key and memory indices wrapped to their sizes.
+ *
+ * @param lane The lane.
+ * @param opcode The instruction.
+ */
+template <size_t LANES>
+void Lockstep<LANES>::ExecuteLane(size_t lane, uint16_t opcode)
+{
+	const unsigned int x = (opcode & 0x0F00u) >> 8u;
+	const unsigned int y = (opcode & 0x00F0u) >> 4u;
+	const uint8_t kk = opcode & 0x00FFu;
+	const uint16_t nnn = opcode & 0x0FFFu;
+	const unsigned int n = opcode & 0x000Fu;
+	const uint8_t a = registers[x][lane];
+	const uint8_t b = registers[y][lane];
+	const uint16_t I = index[lane];
+
+	// VF first, then the result from the registers as they are after it, like setFlag in StepVector
+	auto setFlag = [&](uint8_t flag) { registers[0xF][lane] = flag; };
+
+	switch (Decode(opcode))
+	{
+		case Op::OP_00E0:
+			for (U64& row : video) row[lane] = 0;
+			break;
+		case Op::OP_00EE:
+			sp[lane] -= 1;
+			pc[lane] = stack[sp[lane] & (STACK_LEVELS - 1)][lane];
+			break;
+		case Op::OP_1nnn: pc[lane] = nnn; break;
+		case Op::OP_2nnn:
+			stack[sp[lane] & (STACK_LEVELS - 1)][lane] = pc[lane];
+			sp[lane] += 1;
+			pc[lane] = nnn;
+			break;
+		case Op::OP_3xkk: if (a == kk) pc[lane] += 2; break;
+		case Op::OP_4xkk: if (a != kk) pc[lane] += 2; break;
+		case Op::OP_5xy0:
+		case Op::OP_5xy2:
+		case Op::OP_5xy3: if (a == b) pc[lane] += 2; break;
+		case Op::OP_6xkk: registers[x][lane] = kk; break;
+		case Op::OP_7xkk: registers[x][lane] = a + kk; break;
+		case Op::OP_8xy0: registers[x][lane] = b; break;
+		case Op::OP_8xy1: registers[x][lane] = a | b; break;
+		case Op::OP_8xy2: registers[x][lane] = a & b; break;
+		case Op::OP_8xy3: registers[x][lane] = a ^ b; break;
+		case Op::OP_8xy4: setFlag(a + b > 0xFF ? 1 : 0); registers[x][lane] = a + b; break;
+		case Op::OP_8xy5: setFlag(a > b ? 1 : 0); registers[x][lane] -= registers[y][lane]; break;
+		case Op::OP_8xy6: setFlag(a & 0x1u); registers[x][lane] >>= 1; break;
+		case Op::OP_8xy7: setFlag(b > a ? 1 : 0); registers[x][lane] = registers[y][lane] - registers[x][lane]; break;
+		case Op::OP_8xyE: setFlag((a & 0x80u) >> 7u); registers[x][lane] <<= 1; break;
+		case Op::OP_9xy0: if (a != b) pc[lane] += 2; break;
+		case Op::OP_Annn: index[lane] = nnn; break;
+		case Op::OP_Bnnn: pc[lane] = registers[0][lane] + nnn; break;
+		case Op::OP_Cxkk: registers[x][lane] = random[lane].NextByte() & kk; break;
+		case Op::OP_Dxyn:
+		{
+			const uint8_t xPos = a % VIDEO_WIDTH;
+			const uint8_t yPos = b % VIDEO_HEIGHT;
+			const unsigned int rows = std::min<unsigned int>(n, VIDEO_HEIGHT - yPos);
+			uint64_t collision = 0;
+
+			for (unsigned int row = 0; row < rows; ++row)
+			{
+				uint64_t spriteRow = (static_cast<uint64_t>(memory[(I + row) & (MEMORY_SIZE - 1)][lane]) << 56u) >> xPos;
+				collision |= video[yPos + row][lane] & spriteRow;
+				video[yPos + row][lane] ^= spriteRow;
+			}
+
+			registers[0xF][lane] = collision ? 1 : 0;
+			break;
+		}
+		case Op::OP_Ex9E: if (keypad[a & (KEY_COUNT - 1)][lane]) pc[lane] += 2; break;
+		case Op::OP_ExA1: if (!keypad[a & (KEY_COUNT - 1)][lane]) pc[lane] += 2; break;
+		case Op::OP_Fx07: registers[x][lane] = delayTimer[lane]; break;
+		case Op::OP_Fx0A:
+		{
+			unsigned int key = 0;
+			while (key < KEY_COUNT && !keypad[key][lane]) ++key;
+
+			if (key < KEY_COUNT) registers[x][lane] = key;
+			else pc[lane] -= 2;
+			break;
+		}
+		case Op::OP_Fx15: delayTimer[lane] = a; break;
+		case Op::OP_Fx18: soundTimer[lane] = a; break;
+		case Op::OP_Fx1E: index[lane] = I + a; break;
+		case Op::OP_Fx29: index[lane] = FONTSET_START_ADDRESS + 5 * a; break;
+		case Op::OP_Fx33:
+			memory[(I + 2) & (MEMORY_SIZE - 1)][lane] = a % 10;
+			memory[(I + 1) & (MEMORY_SIZE - 1)][lane] = (a / 10) % 10;
+			memory[I & (MEMORY_SIZE - 1)][lane] = (a / 100) % 10;
+			NoteWrite(I, 3);
+			break;
+		case Op::OP_Fx55:
+			for (unsigned int r = 0; r <= x; ++r)
+			{
+				memory[(I + r) & (MEMORY_SIZE - 1)][lane] = registers[r][lane];
+			}
+			NoteWrite(I, x + 1);
+			break;
+		case Op::OP_Fx65:
+			for (unsigned int r = 0; r <= x; ++r)
+			{
+				registers[r][lane] = memory[(I + r) & (MEMORY_SIZE - 1)][lane];
+			}
+			break;
+		default: break;
+	}
+}
+
+/**
+ * @brief Returns the pc shared by the most lanes (Boyer-Moore majority vote).
+ *
+ * Without a strict majority this is still some lane's pc, which is all Step() needs.
+ */
+template <size_t LANES>
+uint16_t Lockstep<LANES>::MajorityPc() const
+{
+	uint16_t candidate = pc[0];
+	unsigned int votes = 0;
+
+	for (size_t lane = 0; lane < LANES; ++lane)
+	{
+		if (votes == 0) candidate = pc[lane];
+		votes += pc[lane] == candidate ? 1 : -1;
+	}
+
+	return candidate;
+}
+
+/**
+ * @brief Records whether the lanes still agree on a range of memory that was just written.
+ *
+ * @param address The first address written.
+ * @param length The number of bytes written.
+ */
+template <size_t LANES>
+void Lockstep<LANES>::NoteWrite(unsigned int address, unsigned int length)
+{
+	for (unsigned int i = 0; i < length; ++i)
+	{
+		const unsigned int a = (address + i) & (MEMORY_SIZE - 1);
+		divergent[a] = !AllSet(memory[a] == memory[a][0]);
+	}
+}
+
+template class Lockstep<8>;
+template class Lockstep<16>;
+template class Lockstep<32>;
@@ -1,8 +1,22 @@
 #include "../include/Chip8.hpp"
+#include "../include/Debugger.hpp"
+#include "../include/Display.hpp"
+#include "../include/EmulationThread.hpp"
+#include "../include/FrameScheduler.hpp"
+#include "../include/Movie.hpp"
 #include "../include/Platform.hpp"
+#include "../include/Rewind.hpp"
+#include "../include/Tracer.hpp"
+#include <array>
 #include <chrono>
+#include <cmath>
 #include <iostream>
+#include <memory>
 #include <cstdlib>
+#include <cstring>
+#include <random>
+
+constexpr int INPUT_WAIT_MS = 100;   // Longest the window thread sleeps without an event
 
 /**
  * @brief Entry point for the CHIP-8 emulator.
@@ -16,51 +30,208 @@
  */
 int main(int argc, char** argv)
 {
-    // Ensure correct usage
-    if (argc != 4)
+    // Parse command-line arguments: three positional ones, then options
+    if (argc < 4)
     {
-        std::cerr << "Usage: " << argv[0] << " <Scale> <Delay> <ROM>\n";
+        std::cerr << "Usage: " << argv[0] << " <Scale> <InstructionsPerFrame> <ROM> [--seed <N>] [--record <Movie>] [--palette <RRGGBB> <RRGGBB>] [--speed <N>] [--quirks modern|vip|schip|xochip] [--trace <File>] [--debug <Socket>]\n";
         return EXIT_FAILURE;
     }
 
-    // Parse command-line arguments
     int videoScale = std::stoi(argv[1]);
-    int cycleDelay = std::stoi(argv[2]);
+    unsigned int instructionsPerFrame = static_cast<unsigned int>(std::stoul(argv[2]));
     const std::string romFilename = argv[3];
 
+    // Runs are random unless a seed is given; a recording always stores the seed it used
+    uint32_t seed = std::random_device{}();
+    std::string movieFilename;
+    std::string traceFilename;
+    std::string debugSocket;
+    uint32_t onColor = DEFAULT_ON_COLOR;
+    uint32_t offColor = DEFAULT_OFF_COLOR;
+    double speed = 1.0;
+    QuirkProfile quirks = QuirkProfile::Modern;
+    for (int i = 4; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+        {
+            seed = static_cast<uint32_t>(std::stoul(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+        {
+            movieFilename = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--speed") == 0 && i + 1 < argc && std::stod(argv[i + 1]) > 0.0)
+        {
+            speed = std::stod(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--quirks") == 0 && i + 1 < argc && ParseQuirkProfile(argv[i + 1], quirks))
+        {
+            ++i;
+        }
+        else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+        {
+            traceFilename = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--debug") == 0 && i + 1 < argc)
+        {
+            debugSocket = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--palette") == 0 && i + 2 < argc)
+        {
+            // Lit and unlit colors as RGB hex, made opaque RGBA
+            onColor = (static_cast<uint32_t>(std::stoul(argv[++i], nullptr, 16)) << 8u) | 0xFFu;
+            offColor = (static_cast<uint32_t>(std::stoul(argv[++i], nullptr, 16)) << 8u) | 0xFFu;
+        }
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " <Scale> <InstructionsPerFrame> <ROM> [--seed <N>] [--record <Movie>] [--palette <RRGGBB> <RRGGBB>] [--speed <N>] [--quirks modern|vip|schip|xochip] [--trace <File>] [--debug <Socket>]\n";
+            return EXIT_FAILURE;
+        }
+    }
+
     // Create platform window and chip8 instance
     Platform platform("CHIP-8 Emulator", VIDEO_WIDTH * videoScale, VIDEO_HEIGHT * videoScale, VIDEO_WIDTH, VIDEO_HEIGHT);
+    platform.SetPalette(onColor, offColor);
     Chip8 chip8;
-    chip8.LoadROM(romFilename);
-
-    // Determine pitch for rendering the video buffer
-    const int videoPitch = static_cast<int>(sizeof(chip8.video[0]) * VIDEO_WIDTH);
+    chip8.SetQuirks(quirks);
+    chip8.Seed(seed);
+    if (!chip8.LoadROM(romFilename))
+    {
+        std::cerr << "Failed to load ROM: " << romFilename << "\n";
+        return EXIT_FAILURE;
+    }
 
     // Initialize timing variables
-    auto lastCycleTime = std::chrono::high_resolution_clock::now();
+    FrameScheduler scheduler(instructionsPerFrame);
+    scheduler.SetSpeed(speed);
+
+    // Every frame is recorded so holding Backspace can play the session backwards
+    Rewind rewind;
+    scheduler.SetRewind(&rewind);
+
+    // The keypad of every frame is recorded when asked, for replay with chip8-headless --replay
+    Movie movie(seed, instructionsPerFrame, quirks);
+    if (!movieFilename.empty()) scheduler.SetMovie(&movie);
+
+    // Every instruction is recorded when asked, streamed to the file on a background thread
+    std::unique_ptr<TraceRing> traceRing;
+    std::unique_ptr<TraceWriter> traceWriter;
+    if (!traceFilename.empty())
+    {
+        traceRing = std::make_unique<TraceRing>();
+        traceWriter = std::make_unique<TraceWriter>(*traceRing);
+        if (!traceWriter->Open(traceFilename))
+        {
+            std::cerr << "Failed to write trace: " << traceFilename << "\n";
+            return EXIT_FAILURE;
+        }
+        chip8.SetTrace(traceRing.get());
+    }
+
+    // A debugger client may attach to the running machine at any time
+    Debugger debugger(MemorySizeOf(chip8.GetQuirks()));
+    DebugServer debugServer(debugger);
+    if (!debugSocket.empty())
+    {
+        if (!debugServer.Open(debugSocket))
+        {
+            std::cerr << "Failed to open debug socket: " << debugSocket << "\n";
+            return EXIT_FAILURE;
+        }
+        chip8.SetDebugger(&debugger);
+    }
+
+    // Emulation runs on its own thread, so a stalled present never holds back the machine;
+    // this thread only handles input and shows the newest finished frame
+    EmulationThread emulation(chip8, scheduler);
+    emulation.SetFrameListener(&Platform::Wake);
+    emulation.Start();
+
+    // Execution counts for the F1 overlay, in builds configured with CHIP8_PROFILE
+    ProfileCounters const* profile = chip8.Profile();
+
+    std::array<uint8_t, KEY_COUNT> keys{};
     bool quit = false;
 
+    // Frame last presented, to find the rows that changed since even when frames were skipped
+    VideoBuffer shown{};
+
+    // Frames are presented at most once per display refresh; faster than that (--speed, Tab)
+    // the frames in between are dropped
+    using Clock = std::chrono::steady_clock;
+    const auto refreshPeriod = std::chrono::duration<double>(1.0 / platform.RefreshRate());
+    auto nextPresent = Clock::now();
+
     // Main loop
     while (!quit)
     {
-        // Process user input
-        quit = platform.ProcessInput(chip8.keypad.data());
+        // Process user input and hand it to the emulation thread
+        quit = platform.ProcessInput(keys.data());
+        for (unsigned int key = 0; key < KEY_COUNT; ++key)
+        {
+            emulation.SetKey(key, keys[key] != 0);
+        }
+        emulation.SetRewinding(platform.RewindHeld());
+        emulation.SetTurbo(platform.TurboOn());
 
-        // Calculate time difference between cycles
-        auto currentTime = std::chrono::high_resolution_clock::now();
-        float dt = std::chrono::duration<float, std::chrono::milliseconds::period>(currentTime - lastCycleTime).count();
+        // Too early for another present; newer frames replace the waiting one meanwhile
+        auto now = Clock::now();
+        if (now < nextPresent && !platform.RedrawNeeded())
+        {
+            platform.WaitForEvent(static_cast<int>(std::ceil(std::chrono::duration<double, std::milli>(nextPresent - now).count())));
+            continue;
+        }
 
-        // Execute the next cycle if the delay has passed
-        if (dt > static_cast<float>(cycleDelay))
+        // Present the newest frame if there is one, drawing only the rows that differ from the last
+        // frame shown; the platform asks for the first frame to be drawn in full anyway
+        bool fresh = emulation.TakeFrame();
+        bool overlay = profile && platform.OverlayOn();
+        if (fresh || platform.RedrawNeeded() || overlay)
         {
-            lastCycleTime = currentTime;
+            VideoBuffer const& frame = emulation.Frame();
+            int firstRow = 0;
+            int rowCount = 0;
+            if (platform.RedrawNeeded() || frame.hires != shown.hires)
+            {
+                rowCount = static_cast<int>(frame.Height());
+            }
+            else
+            {
+                int lastRow = -1;
+                for (int row = 0; row < static_cast<int>(frame.Height()); ++row)
+                {
+                    if (frame.SameRow(shown, row)) continue;
+                    if (lastRow < 0) firstRow = row;
+                    lastRow = row;
+                }
+                rowCount = lastRow + 1 - firstRow;
+            }
+            platform.Present(frame, firstRow, rowCount, profile);
+            shown = frame;
+            nextPresent = now + std::chrono::duration_cast<Clock::duration>(refreshPeriod);
+        }
+        else
+        {
+            // Nothing new to show; sleep until a key event or the next published frame wakes us
+            platform.WaitForEvent(INPUT_WAIT_MS);
+        }
+    }
 
-            // Emulate one cycle of CHIP-8
-            chip8.Cycle();
+    // The machine, scheduler and movie are only touched here again once the thread is done;
+    // closing the debug socket first lets a stopped machine finish its frame
+    debugServer.Close();
+    emulation.Stop();
 
-            // Update the display with the latest video buffer
-            platform.Update(chip8.video.data(), videoPitch);
-        }
+    if (traceWriter && !traceWriter->Close())
+    {
+        std::cerr << "Failed to write trace: " << traceFilename << "\n";
+        return EXIT_FAILURE;
+    }
+
+    if (!movieFilename.empty() && !movie.Save(movieFilename))
+    {
+        std::cerr << "Failed to write movie: " << movieFilename << "\n";
+        return EXIT_FAILURE;
     }
 
     return 0;
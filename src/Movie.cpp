@@ -0,0 +1,205 @@
+#include "../include/Movie.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <utility>
+
+namespace
+{
+	// Movie files start with a magic number, the format version, the seed, the instructions per frame,
+	// the quirk profile (one byte, since version 2), the number of frames and the number of changes,
+	// little-endian. Each change follows as the frames
+	// since the previous change (LEB128) and the 16-bit key mask.
+	constexpr std::array<uint8_t, 4> MOVIE_MAGIC = {'C', '8', 'M', 'V'};
+
+	void Put(std::vector<uint8_t>& out, uint64_t value, unsigned int bytes)
+	{
+		for (unsigned int i = 0; i < bytes; ++i)
+		{
+			out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+		}
+	}
+
+	// Reads a little-endian value, failing past the end of the data
+	bool Get(uint8_t const*& in, uint8_t const* end, unsigned int bytes, uint64_t& value)
+	{
+		if (static_cast<size_t>(end - in) < bytes) return false;
+
+		value = 0;
+		for (unsigned int i = 0; i < bytes; ++i)
+		{
+			value |= static_cast<uint64_t>(*in++) << (8 * i);
+		}
+		return true;
+	}
+
+	void PutVarint(std::vector<uint8_t>& out, uint64_t value)
+	{
+		for (; value >= 0x80; value >>= 7)
+		{
+			out.push_back(static_cast<uint8_t>(value | 0x80));
+		}
+		out.push_back(static_cast<uint8_t>(value));
+	}
+
+	bool GetVarint(uint8_t const*& in, uint8_t const* end, uint64_t& value)
+	{
+		value = 0;
+		for (unsigned int shift = 0; in < end && shift < 64; shift += 7)
+		{
+			uint8_t byte = *in++;
+			value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+			if (!(byte & 0x80)) return true;
+		}
+		return false;
+	}
+}
+
+/**
+ * @brief Constructs an empty movie for a run with the given seed and speed.
+ *
+ * @param seed The seed the recorded machine was given.
+ * @param instructionsPerFrame The number of instructions per frame of the recorded run.
+ * @param quirks The quirk profile of the recorded machine.
+ */
+Movie::Movie(uint32_t seed, unsigned int instructionsPerFrame, QuirkProfile quirks)
+	: seed(seed), instructionsPerFrame(instructionsPerFrame), quirks(quirks)
+{
+}
+
+/**
+ * @brief Appends a frame, storing a change if its keypad differs from the previous frame's.
+ *
+ * @param keypad The keypad state the frame runs with.
+ */
+void Movie::Record(std::array<uint8_t, KEY_COUNT> const& keypad)
+{
+	uint16_t keys = 0;
+	for (unsigned int i = 0; i < KEY_COUNT; ++i)
+	{
+		if (keypad[i]) keys |= static_cast<uint16_t>(1u << i);
+	}
+
+	uint16_t previous = changes.empty() ? 0 : changes.back().keys;
+	if (keys != previous) changes.push_back(Change{frames, keys});
+
+	++frames;
+}
+
+/**
+ * @brief Drops the newest recorded frame and any change made on it.
+ */
+void Movie::DropFrame()
+{
+	if (frames == 0) return;
+
+	--frames;
+	while (!changes.empty() && changes.back().frame >= frames)
+	{
+		changes.pop_back();
+	}
+}
+
+/**
+ * @brief Sets the keypad for the next replayed frame.
+ *
+ * @param keypad Receives the keypad state.
+ * @return false once every recorded frame has been replayed.
+ */
+bool Movie::Play(std::array<uint8_t, KEY_COUNT>& keypad)
+{
+	if (playFrame >= frames) return false;
+
+	for (; playChange < changes.size() && changes[playChange].frame == playFrame; ++playChange)
+	{
+		playKeys = changes[playChange].keys;
+	}
+
+	for (unsigned int i = 0; i < KEY_COUNT; ++i)
+	{
+		keypad[i] = (playKeys >> i) & 1u;
+	}
+
+	++playFrame;
+	return true;
+}
+
+/**
+ * @brief Writes the movie to a file.
+ *
+ * @param filename The path to the file.
+ * @return true if the file was written.
+ */
+bool Movie::Save(const std::string& filename) const
+{
+	std::vector<uint8_t> data(MOVIE_MAGIC.begin(), MOVIE_MAGIC.end());
+	Put(data, MOVIE_VERSION, 4);
+	Put(data, seed, 4);
+	Put(data, instructionsPerFrame, 4);
+	Put(data, static_cast<uint8_t>(quirks), 1);
+	Put(data, frames, 8);
+	Put(data, changes.size(), 4);
+
+	uint64_t previous = 0;
+	for (Change const& change : changes)
+	{
+		PutVarint(data, change.frame - previous);
+		Put(data, change.keys, 2);
+		previous = change.frame;
+	}
+
+	std::ofstream file(filename, std::ios::binary);
+	file.write(reinterpret_cast<char const*>(data.data()), static_cast<std::streamsize>(data.size()));
+	return static_cast<bool>(file);
+}
+
+/**
+ * @brief Reads a movie from a file and rewinds replay to its first frame.
+ *
+ * @param filename The path to the file.
+ * @return true if the file was read and is a valid movie; false leaves the movie unchanged.
+ */
+bool Movie::Load(const std::string& filename)
+{
+	std::ifstream file(filename, std::ios::binary);
+
+	if (!file.is_open()) return false;
+
+	std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	if (file.bad() || data.size() < MOVIE_MAGIC.size() || !std::equal(MOVIE_MAGIC.begin(), MOVIE_MAGIC.end(), data.begin())) return false;
+
+	uint8_t const* in = data.data() + MOVIE_MAGIC.size();
+	uint8_t const* end = data.data() + data.size();
+	uint64_t version, newSeed, newInstructionsPerFrame, newQuirks = 0, newFrames, count;
+	if (!Get(in, end, 4, version) || version == 0 || version > MOVIE_VERSION
+		|| !Get(in, end, 4, newSeed) || !Get(in, end, 4, newInstructionsPerFrame)
+		|| (version >= 2 && !Get(in, end, 1, newQuirks))
+		|| !Get(in, end, 8, newFrames) || !Get(in, end, 4, count)) return false;
+	if (newQuirks > static_cast<uint64_t>(QuirkProfile::XoChip)) return false;
+
+	// Every change takes at least three bytes, which bounds the count before reserving for it
+	if (count > static_cast<size_t>(end - in) / 3) return false;
+
+	std::vector<Change> newChanges;
+	newChanges.reserve(count);
+	uint64_t frame = 0;
+	for (uint64_t i = 0; i < count; ++i)
+	{
+		uint64_t delta, keys;
+		if (!GetVarint(in, end, delta) || !Get(in, end, 2, keys)) return false;
+
+		frame += delta;
+		if ((i > 0 && delta == 0) || frame >= newFrames) return false;
+		newChanges.push_back(Change{frame, static_cast<uint16_t>(keys)});
+	}
+
+	seed = static_cast<uint32_t>(newSeed);
+	instructionsPerFrame = static_cast<unsigned int>(newInstructionsPerFrame);
+	quirks = static_cast<QuirkProfile>(newQuirks);
+	frames = newFrames;
+	changes = std::move(newChanges);
+	playFrame = 0;
+	playChange = 0;
+	playKeys = 0;
+	return true;
+}
@@ -1,8 +1,14 @@
 #include "../include/Platform.hpp"
 #include <SDL.h>
+#include <algorithm>
+#include <cmath>
+#include <string>
 
-// Constructor: Initializes the SDL window, OpenGL context, and textures.
+constexpr Uint32 OVERLAY_SAMPLE_MS = 500;   // Interval the overlay's rates and heatmap cover
+
+// Constructor: Initializes the SDL window, renderer, and texture.
 Platform::Platform(char const* title, int windowWidth, int windowHeight, int textureWidth, int textureHeight)
+    : textureWidth(textureWidth), textureHeight(textureHeight)
 {
     // Initialize SDL with video support
     if (SDL_Init(SDL_INIT_VIDEO) != 0) {
@@ -24,8 +30,11 @@ Platform::Platform(char const* title, int windowWidth, int windowHeight, int tex
         return;
     }
 
-    // Create SDL Renderer for the window
+    // Create SDL Renderer for the window, in software on machines without a GPU
     renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+    if (!renderer) {
+        renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_SOFTWARE);
+    }
     
     // Check if renderer creation was successful
     if (!renderer) {
@@ -52,26 +61,193 @@ Platform::Platform(char const* title, int windowWidth, int windowHeight, int tex
 Platform::~Platform()
 {
     // Clean up SDL resources
+    if (heatmap) SDL_DestroyTexture(heatmap);
     if (texture) SDL_DestroyTexture(texture);
     if (renderer) SDL_DestroyRenderer(renderer);
     if (window) SDL_DestroyWindow(window);
     SDL_Quit();
 }
 
-// Updates the texture with new pixel data.
-void Platform::Update(void const* buffer, int pitch)
+// Expands the changed rows of the display straight into the texture and presents the frame.
+void Platform::Present(VideoBuffer const& video, int firstRow, int rowCount, ProfileCounters const* profile)
 {
-    // Update the texture with the provided buffer
-    SDL_UpdateTexture(texture, nullptr, buffer, pitch);
+    // A resolution switch (SUPER-CHIP 00FE/00FF) needs a texture of the new size, drawn in full
+    int width = static_cast<int>(video.Width());
+    int height = static_cast<int>(video.Height());
+    if (width != textureWidth || height != textureHeight)
+    {
+        SDL_Texture* resized = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_STREAMING, width, height);
+        if (resized)
+        {
+            if (texture) SDL_DestroyTexture(texture);
+            texture = resized;
+            textureWidth = width;
+            textureHeight = height;
+            firstRow = 0;
+            rowCount = height;
+        }
+        else
+        {
+            SDL_Log("Failed to resize texture: %s", SDL_GetError());
+            rowCount = 0;
+        }
+    }
+
+    // Lock only the rows that changed and expand them in place; the locked memory is write-only,
+    // so every pixel of those rows is written. No rows means the texture is current already.
+    if (rowCount > 0)
+    {
+        SDL_Rect rows = {0, firstRow, textureWidth, rowCount};
+        void* pixels = nullptr;
+        int pitch = 0;
+        if (SDL_LockTexture(texture, &rows, &pixels, &pitch) == 0)
+        {
+            ExpandVideo(video, static_cast<uint32_t*>(pixels), pitch, static_cast<unsigned int>(firstRow),
+                        static_cast<unsigned int>(rowCount), palette);
+            SDL_UnlockTexture(texture);
+        }
+    }
 
     // Clear the screen
     SDL_RenderClear(renderer);
 
-    // Copy the updated texture to the rendering target (the window)
+    // Copy the texture to the rendering target (the window)
     SDL_RenderCopy(renderer, texture, nullptr, nullptr);
 
+    // Draw the profiler overlay on top when asked
+    if (overlayOn && profile) DrawOverlay(*profile);
+
     // Present the updated frame on the window
     SDL_RenderPresent(renderer);
+    redrawNeeded = false;
+}
+
+// Draws the profiler overlay, taking a new sample of the counts every OVERLAY_SAMPLE_MS.
+void Platform::DrawOverlay(ProfileCounters const& profile)
+{
+    if (!heatmap)
+    {
+        heatmap = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_STREAMING, 64, CODE_SPACE / 64);
+        if (!heatmap) return;
+        SDL_SetTextureBlendMode(heatmap, SDL_BLENDMODE_BLEND);
+    }
+
+    Uint32 now = SDL_GetTicks();
+    if (now - sampleTicks >= OVERLAY_SAMPLE_MS)
+    {
+        double seconds = (now - sampleTicks) / 1000.0;
+
+        // Heat is logarithmic in the hits since the last sample, so loops stand out without hiding the rest
+        std::array<uint64_t, CODE_SPACE> hits{};
+        uint64_t maxHits = 1;
+        for (unsigned int address = 0; address < CODE_SPACE; ++address)
+        {
+            uint64_t total = profile.pcHits[address].load(std::memory_order_relaxed);
+            hits[address] = total - sampleHits[address];
+            sampleHits[address] = total;
+            maxHits = std::max(maxHits, hits[address]);
+        }
+
+        void* pixels = nullptr;
+        int pitch = 0;
+        if (SDL_LockTexture(heatmap, nullptr, &pixels, &pitch) == 0)
+        {
+            for (unsigned int address = 0; address < CODE_SPACE; ++address)
+            {
+                uint32_t* pixel = reinterpret_cast<uint32_t*>(static_cast<uint8_t*>(pixels) + (address / 64) * pitch) + address % 64;
+                double heat = hits[address] ? std::log2(1.0 + hits[address]) / std::log2(1.0 + maxHits) : 0.0;
+                *pixel = hits[address] ? 0xFF400000u | static_cast<uint32_t>(48 + 160 * heat) : 0u;
+            }
+            SDL_UnlockTexture(heatmap);
+        }
+
+        uint64_t instructions = 0;
+        for (size_t op = 0; op < OP_COUNT; ++op)
+        {
+            uint64_t total = profile.ops[op].load(std::memory_order_relaxed);
+            opsDelta[op] = total - sampleOps[op];
+            sampleOps[op] = total;
+            instructions += opsDelta[op];
+        }
+        uint64_t frames = profile.frames.load(std::memory_order_relaxed);
+
+        instructionsPerSecond = sampleTicks ? static_cast<uint64_t>(instructions / seconds) : 0;
+        framesPerSecond = sampleTicks ? static_cast<uint64_t>((frames - sampleFrames) / seconds) : 0;
+        sampleFrames = frames;
+        sampleTicks = now;
+    }
+
+    int width = 0;
+    int height = 0;
+    SDL_GetRendererOutputSize(renderer, &width, &height);
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+
+    // Address heatmap over the whole window, row by row from address 0
+    SDL_RenderCopy(renderer, heatmap, nullptr, nullptr);
+
+    // Each handler's share of the instructions since the last sample, along the bottom
+    uint64_t maxOps = std::max<uint64_t>(1, *std::max_element(opsDelta.begin(), opsDelta.end()));
+    int barWidth = std::max(1, width / static_cast<int>(OP_COUNT));
+    SDL_SetRenderDrawColor(renderer, 0xFF, 0xC0, 0x00, 0xC0);
+    for (size_t op = 0; op < OP_COUNT; ++op)
+    {
+        int barHeight = static_cast<int>(opsDelta[op] * static_cast<uint64_t>(height / 4) / maxOps);
+        SDL_Rect bar = {static_cast<int>(op) * barWidth, height - barHeight, barWidth - 1, barHeight};
+        SDL_RenderFillRect(renderer, &bar);
+    }
+
+    // Instructions per second over frames per second, top left
+    int scale = std::max(1, height / 160);
+    SDL_Rect panel = {0, 0, 21 * 5 * scale + 2 * scale, 14 * scale};
+    SDL_SetRenderDrawColor(renderer, 0x00, 0x00, 0x00, 0xA0);
+    SDL_RenderFillRect(renderer, &panel);
+    SDL_SetRenderDrawColor(renderer, 0xFF, 0xFF, 0xFF, 0xFF);
+    DrawNumber(instructionsPerSecond, scale, scale, scale);
+    DrawNumber(framesPerSecond, scale, 7 * scale, scale);
+}
+
+// Draws a decimal number with the digit sprites of the built-in font, four pixels wide and five high.
+void Platform::DrawNumber(uint64_t value, int x, int y, int scale)
+{
+    for (char digit : std::to_string(value))
+    {
+        for (unsigned int row = 0; row < 5; ++row)
+        {
+            uint8_t bits = fontset[(digit - '0') * 5u + row];
+            for (unsigned int column = 0; column < 4; ++column)
+            {
+                if (!(bits & (0x80u >> column))) continue;
+                SDL_Rect pixel = {x + static_cast<int>(column) * scale, y + static_cast<int>(row) * scale, scale, scale};
+                SDL_RenderFillRect(renderer, &pixel);
+            }
+        }
+        x += 5 * scale;
+    }
+}
+
+// Returns the refresh rate of the window's display, in Hz; 60 if SDL does not know it.
+int Platform::RefreshRate() const
+{
+    SDL_DisplayMode mode{};
+    if (window && SDL_GetCurrentDisplayMode(SDL_GetWindowDisplayIndex(window), &mode) == 0 && mode.refresh_rate > 0)
+    {
+        return mode.refresh_rate;
+    }
+    return 60;
+}
+
+// Sleeps until an event is queued or the timeout passes, leaving the event for ProcessInput().
+void Platform::WaitForEvent(int timeoutMs)
+{
+    SDL_WaitEventTimeout(nullptr, timeoutMs);
+}
+
+// Wakes the event loop by queueing a user event, which ProcessInput() drops; SDL_PushEvent is thread-safe.
+void Platform::Wake()
+{
+    SDL_Event event{};
+    event.type = SDL_USEREVENT;
+    SDL_PushEvent(&event);
 }
 
 // Processes input events and updates the state of the keys.
@@ -90,12 +266,23 @@ bool Platform::ProcessInput(uint8_t* keys)
                 quit = true;
                 break;
 
+            case SDL_WINDOWEVENT:
+                // The window contents must be presented again after being uncovered or resized
+                if (event.window.event == SDL_WINDOWEVENT_EXPOSED || event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED)
+                {
+                    redrawNeeded = true;
+                }
+                break;
+
             case SDL_KEYDOWN:
             {
                 // Handle key down events
                 switch (event.key.keysym.sym)
                 {
                     case SDLK_ESCAPE: quit = true; break;
+                    case SDLK_BACKSPACE: rewindHeld = true; break;
+                    case SDLK_TAB: if (!event.key.repeat) turbo = !turbo; break;
+                    case SDLK_F1: if (!event.key.repeat) overlayOn = !overlayOn; break;
                     case SDLK_x: keys[0] = 1; break;
                     case SDLK_1: keys[1] = 1; break;
                     case SDLK_2: keys[2] = 1; break;
@@ -121,6 +308,7 @@ bool Platform::ProcessInput(uint8_t* keys)
                 // Handle key up events
                 switch (event.key.keysym.sym)
                 {
+                    case SDLK_BACKSPACE: rewindHeld = false; break;
                     case SDLK_x: keys[0] = 0; break;
                     case SDLK_1: keys[1] = 0; break;
                     case SDLK_2: keys[2] = 0; break;
@@ -0,0 +1,360 @@
+#include "../include/Chip8.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+// Instructions emitted into one block at most; longer runs continue in a following block
+constexpr unsigned int MAX_BLOCK_LENGTH = 256;
+
+namespace
+{
+    /**
+     * @brief A block discovered by the control-flow walk.
+     */
+    struct Block
+    {
+        uint16_t start;
+        uint16_t end;
+        std::string body;
+    };
+
+    /**
+     * @brief Formats a value as C hex.
+     */
+    std::string Hex(unsigned int value, int digits)
+    {
+        char buffer[16];
+        std::snprintf(buffer, sizeof(buffer), "0x%0*X", digits, value);
+        return buffer;
+    }
+
+    /**
+     * @brief Walks the ROM's control flow from START_ADDRESS and emits one C++ function body per block.
+     *
+     * Successors come from 1nnn, 2nnn (target and return site), the skips (both outcomes) and
+     * instructions that end a block for other reasons. 00EE and Bnnn have no static successor:
+     * the return site is already known from the call, and Bnnn targets are left to the interpreter.
+     */
+    class Recompiler
+    {
+    public:
+        Recompiler(std::vector<uint8_t> const& rom, QuirkProfile profile) : rom(rom), quirks(QuirksOf(profile)) {}
+
+        std::map<uint16_t, Block> Run()
+        {
+            std::vector<uint16_t> work{static_cast<uint16_t>(START_ADDRESS)};
+            std::set<uint16_t> seen;
+
+            while (!work.empty())
+            {
+                uint16_t start = work.back();
+                work.pop_back();
+                if (!seen.insert(start).second || !InRom(start)) continue;
+
+                std::vector<uint16_t> successors;
+                blocks[start] = Translate(start, successors);
+                work.insert(work.end(), successors.begin(), successors.end());
+            }
+
+            return blocks;
+        }
+
+    private:
+        bool InRom(unsigned int address) const
+        {
+            return address >= START_ADDRESS && address + 2 <= START_ADDRESS + rom.size();
+        }
+
+        uint16_t OpcodeAt(unsigned int address) const
+        {
+            return static_cast<uint16_t>((rom[address - START_ADDRESS] << 8u) | rom[address - START_ADDRESS + 1]);
+        }
+
+        Block Translate(uint16_t start, std::vector<uint16_t>& successors)
+        {
+            std::string out;
+            uint16_t a = start;
+            bool ended = false;
+
+            // One past the last byte the block depends on, when that is past its last instruction
+            uint16_t end = start;
+
+            for (unsigned int count = 0; count < MAX_BLOCK_LENGTH && !ended && InRom(a); ++count, a += 2)
+            {
+                const uint16_t opcode = OpcodeAt(a);
+                const unsigned int x = (opcode & 0x0F00u) >> 8u;
+                const unsigned int y = (opcode & 0x00F0u) >> 4u;
+                const unsigned int kk = opcode & 0x00FFu;
+                const unsigned int nnn = opcode & 0x0FFFu;
+                const std::string A = Hex(a, 3);
+                const std::string next = Hex(a + 2u, 3);
+
+                // XO-CHIP skips step over all four bytes of an F000 NNNN
+                const bool longNext = quirks.xoChip && InRom(a + 2u) && OpcodeAt(a + 2u) == 0xF000;
+                const unsigned int skipped = a + (longNext ? 6u : 4u);
+                const std::string skip = Hex(skipped, 3);
+                const std::string Vx = "V[" + Hex(x, 1) + "]";
+                const std::string Vy = "V[" + Hex(y, 1) + "]";
+                const std::string resetVF = quirks.resetVF ? " V[0xF] = 0;" : "";
+
+                out += "\n    // " + A + ": " + Hex(opcode, 4) + "\n";
+                out += "    if (cycles == 0) { pc = " + A + "; return 0; }\n";
+                out += "    --cycles;\n";
+
+                auto skipIf = [&](std::string const& condition) {
+                    out += "    pc = (" + condition + ") ? " + skip + " : " + next + ";\n";
+                    out += "    return cycles;\n";
+                    successors.push_back(a + 2);
+                    successors.push_back(skipped);
+                    if (quirks.xoChip) end = a + 4;
+                    ended = true;
+                };
+
+                // Falls back to the interpreter's handler; `terminal` handlers may change pc or write memory
+                auto execute = [&](bool terminal) {
+                    out += "    StaticRuntime::Execute(chip8, " + A + ");\n";
+                    if (terminal)
+                    {
+                        out += "    return cycles;\n";
+                        ended = true;
+                    }
+                };
+
+                switch ((opcode & 0xF000u) >> 12u)
+                {
+                    case 0x0:
+                        // Decoded like the interpreter, so 0nnE returns like 00EE
+                        if (Decode(opcode) == Op::OP_00EE)
+                        {
+                            out += "    pc = S[--sp & " + Hex(STACK_LEVELS - 1, 1) + "];\n";
+                            out += "    return cycles;\n";
+                            ended = true;
+                        }
+                        else if (opcode == 0x00FD && quirks.superChip)
+                        {
+                            // Exit: the handler leaves pc on the instruction
+                            execute(true);
+                            successors.push_back(a);
+                        }
+                        else
+                        {
+                            execute(false);
+                        }
+                        break;
+
+                    case 0x1:
+                        out += "    pc = " + Hex(nnn, 3) + ";\n";
+                        out += "    return cycles;\n";
+                        successors.push_back(nnn);
+                        ended = true;
+                        break;
+
+                    case 0x2:
+                        out += "    S[sp++ & " + Hex(STACK_LEVELS - 1, 1) + "] = " + next + ";\n";
+                        out += "    pc = " + Hex(nnn, 3) + ";\n";
+                        out += "    return cycles;\n";
+                        successors.push_back(nnn);
+                        successors.push_back(a + 2);
+                        ended = true;
+                        break;
+
+                    case 0x3: skipIf(Vx + " == " + Hex(kk, 2)); break;
+                    case 0x4: skipIf(Vx + " != " + Hex(kk, 2)); break;
+                    case 0x5:
+                        if (quirks.xoChip && (opcode & 0x000Fu) == 0x2)
+                        {
+                            // Stores Vx-Vy at I
+                            execute(true);
+                            successors.push_back(a + 2);
+                        }
+                        else if (quirks.xoChip && (opcode & 0x000Fu) == 0x3)
+                        {
+                            execute(false);
+                        }
+                        else
+                        {
+                            skipIf(x == y ? "true" : Vx + " == " + Vy);
+                        }
+                        break;
+                    case 0x6: out += "    " + Vx + " = " + Hex(kk, 2) + ";\n"; break;
+                    case 0x7: out += "    " + Vx + " += " + Hex(kk, 2) + ";\n"; break;
+                    case 0x8:
+                        // Same operation order as the interpreter, so VF writes behave identically when x or y is F
+                        switch (opcode & 0x000Fu)
+                        {
+                            case 0x0: out += "    " + Vx + " = " + Vy + ";\n"; break;
+                            case 0x1: out += "    " + Vx + " |= " + Vy + ";" + resetVF + "\n"; break;
+                            case 0x2: out += "    " + Vx + " &= " + Vy + ";" + resetVF + "\n"; break;
+                            case 0x3: out += "    " + Vx + " ^= " + Vy + ";" + resetVF + "\n"; break;
+                            case 0x4:
+                                out += "    { unsigned int sum = " + Vx + " + " + Vy + "; V[0xF] = sum > 0xFF ? 1 : 0; " + Vx + " = static_cast<uint8_t>(sum); }\n";
+                                break;
+                            case 0x5:
+                            case 0x7:
+                                if (x == y)
+                                {
+                                    // Vx - Vx never borrows; spelled out to keep the generated code free of self-comparisons
+                                    out += "    V[0xF] = 0; " + Vx + " = 0;\n";
+                                }
+                                else if ((opcode & 0x000Fu) == 0x5)
+                                {
+                                    out += "    V[0xF] = " + Vx + " > " + Vy + " ? 1 : 0; " + Vx + " -= " + Vy + ";\n";
+                                }
+                                else
+                                {
+                                    out += "    V[0xF] = " + Vy + " > " + Vx + " ? 1 : 0; " + Vx + " = " + Vy + " - " + Vx + ";\n";
+                                }
+                                break;
+                            case 0x6:
+                                if (quirks.shiftVy) out += "    { uint8_t value = " + Vy + "; " + Vx + " = value >> 1; V[0xF] = value & 0x1; }\n";
+                                else out += "    V[0xF] = " + Vx + " & 0x1; " + Vx + " >>= 1;\n";
+                                break;
+                            case 0xE:
+                                if (quirks.shiftVy) out += "    { uint8_t value = " + Vy + "; " + Vx + " = static_cast<uint8_t>(value << 1); V[0xF] = (value & 0x80) >> 7; }\n";
+                                else out += "    V[0xF] = (" + Vx + " & 0x80) >> 7; " + Vx + " <<= 1;\n";
+                                break;
+                            default:
+                                break;
+                        }
+                        break;
+                    case 0x9: skipIf(x == y ? "false" : Vx + " != " + Vy); break;
+                    case 0xA: out += "    I = " + Hex(nnn, 3) + ";\n"; break;
+                    case 0xB: execute(true); break;
+                    case 0xE:
+                        execute(true);
+                        successors.push_back(a + 2);
+                        successors.push_back(skipped);
+                        break;
+                    case 0xF:
+                        if (kk == 0x0A || kk == 0x33 || kk == 0x55)
+                        {
+                            execute(true);
+                            successors.push_back(a + 2);
+                        }
+                        else if (opcode == 0xF000 && quirks.xoChip)
+                        {
+                            // Loads I from the next word and steps over it
+                            execute(true);
+                            successors.push_back(a + 4);
+                            end = a + 4;
+                        }
+                        else
+                        {
+                            execute(false);
+                        }
+                        break;
+                    default:
+                        execute(false);
+                        break;
+                }
+            }
+
+            if (!ended)
+            {
+                out += "\n    pc = " + Hex(a, 3) + ";\n";
+                out += "    return cycles;\n";
+                successors.push_back(a);
+            }
+
+            return Block{start, std::max(a, end), out};
+        }
+
+        std::vector<uint8_t> const& rom;
+        Quirks quirks;
+        std::map<uint16_t, Block> blocks;
+    };
+}
+
+/**
+ * @brief Entry point for the CHIP-8 static recompiler.
+ *
+ * Writes a C++ translation unit defining `staticProgram`: the ROM bytes plus one function per basic block.
+ * Compiling it together with StaticMain.cpp gives a ROM-specific executable.
+ *
+ * @param argc The number of command-line arguments.
+ * @param argv The array of command-line arguments.
+ * @return int Returns EXIT_SUCCESS on successful execution, or EXIT_FAILURE on error.
+ */
+int main(int argc, char** argv)
+{
+    // The generated code implements one quirk profile, recorded in the program
+    QuirkProfile profile = QuirkProfile::Modern;
+    if (argc != 3 && !(argc == 5 && std::strcmp(argv[3], "--quirks") == 0 && ParseQuirkProfile(argv[4], profile)))
+    {
+        std::cerr << "Usage: " << argv[0] << " <ROM> <Output.cpp> [--quirks modern|vip|schip|xochip]\n";
+        return EXIT_FAILURE;
+    }
+
+    std::ifstream file(argv[1], std::ios::binary);
+    std::vector<uint8_t> rom((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (!file.good() && !file.eof())
+    {
+        std::cerr << "Failed to read ROM: " << argv[1] << "\n";
+        return EXIT_FAILURE;
+    }
+    if (rom.empty() || rom.size() > RomCapacity(profile))
+    {
+        std::cerr << "ROM is empty or does not fit in program memory: " << argv[1] << "\n";
+        return EXIT_FAILURE;
+    }
+
+    std::map<uint16_t, Block> blocks = Recompiler(rom, profile).Run();
+
+    std::ofstream out(argv[2]);
+    out << "// Generated by chip8-recompile from " << argv[1] << ". Do not edit.\n";
+    out << "#include \"StaticProgram.hpp\"\n\n";
+    out << "namespace\n{\n";
+
+    out << "const uint8_t rom[] = {";
+    for (size_t i = 0; i < rom.size(); ++i)
+    {
+        out << (i % 16 == 0 ? "\n    " : " ") << Hex(rom[i], 2) << ",";
+    }
+    out << "\n};\n";
+
+    for (auto const& entry : blocks)
+    {
+        Block const& block = entry.second;
+        out << "\nunsigned int Block_" << Hex(block.start, 3) << "(Chip8& chip8, unsigned int cycles)\n{\n";
+        out << "    uint8_t* V = StaticRuntime::Registers(chip8);\n";
+        out << "    uint16_t* S = StaticRuntime::Stack(chip8);\n";
+        out << "    uint16_t& pc = StaticRuntime::Pc(chip8);\n";
+        out << "    uint16_t& I = StaticRuntime::Index(chip8);\n";
+        out << "    uint8_t& sp = StaticRuntime::Sp(chip8);\n";
+        out << "    (void)V; (void)S; (void)I; (void)sp;\n";
+        out << block.body;
+        out << "}\n";
+    }
+
+    out << "\nconst StaticBlock blocks[] = {\n";
+    for (auto const& entry : blocks)
+    {
+        Block const& block = entry.second;
+        out << "    {" << Hex(block.start, 3) << ", " << Hex(block.end, 3) << ", Block_" << Hex(block.start, 3) << "},\n";
+    }
+    out << "};\n";
+    out << "}\n\n";
+
+    out << "extern const StaticProgram staticProgram;\n";
+    char const* profileName = profile == QuirkProfile::CosmacVip ? "CosmacVip" : profile == QuirkProfile::SuperChip ? "SuperChip"
+        : profile == QuirkProfile::XoChip ? "XoChip" : "Modern";
+    out << "const StaticProgram staticProgram = {rom, sizeof(rom), blocks, sizeof(blocks) / sizeof(blocks[0]), QuirkProfile::" << profileName << "};\n";
+
+    if (!out)
+    {
+        std::cerr << "Failed to write " << argv[2] << "\n";
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "recompiled " << blocks.size() << " blocks from " << argv[1] << "\n";
+    return EXIT_SUCCESS;
+}
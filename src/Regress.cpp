@@ -0,0 +1,552 @@
+#include "../include/Chip8.hpp"
+#include "../include/Lockstep.hpp"
+#include "../include/Movie.hpp"
+#include "../include/ThreadPool.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// Defaults for manifest entries that leave a setting out
+constexpr uint64_t     DEFAULT_FRAMES                 = 600;
+constexpr unsigned int DEFAULT_INSTRUCTIONS_PER_FRAME = 10;
+constexpr uint64_t     DEFAULT_CHECKPOINT_INTERVAL    = 60;
+
+// Lanes of the lockstep group that runs each ROM with --lockstep
+constexpr size_t LOCKSTEP_LANES = 8;
+
+// Pixels per CHIP-8 pixel in diff images
+constexpr unsigned int DIFF_SCALE = 4;
+
+// Bytes per checkpoint in golden frame files: a resolution byte, then every plane's words
+constexpr size_t GOLDEN_FRAME_SIZE = 1 + 8 * VIDEO_PLANES * VIDEO_PLANE_WORDS;
+
+/**
+ * One line of the manifest. ROM lines read
+ *
+ *     <rom> [frames=<N>] [ipf=<N>] [seed=<N>] [every=<N>] [quirks=<profile>] [movie=<file>] <hash> <hash> ...
+ *
+ * with paths relative to the manifest, and one framebuffer hash per checkpoint (every N frames up to
+ * the last frame). A movie supplies the seed, the instructions per frame, the quirk profile and the
+ * input of every frame.
+ * Blank lines and lines starting with '#' are kept as they are.
+ */
+struct ManifestEntry
+{
+    std::string text;
+    bool isRom = false;
+
+    std::string rom;
+    uint64_t frames = DEFAULT_FRAMES;
+    unsigned int instructionsPerFrame = DEFAULT_INSTRUCTIONS_PER_FRAME;
+    uint32_t seed = 0;
+    uint64_t every = DEFAULT_CHECKPOINT_INTERVAL;
+    QuirkProfile quirks = QuirkProfile::Modern;
+    std::string movie;
+    std::vector<uint64_t> golden;
+
+    // Results of the run: the framebuffer and its hash at every checkpoint, or why it did not run
+    std::vector<VideoBuffer> frameBuffers;
+    std::vector<uint64_t> hashes;
+    std::string error;
+    bool skipped = false;
+};
+
+/**
+ * @brief Parses a backend name given on the command line.
+ *
+ * @param name The backend name.
+ * @param backend Receives the backend if the name is valid.
+ * @return true if the name is valid.
+ */
+static bool ParseBackend(char const* name, Backend& backend)
+{
+    if (std::strcmp(name, "table") == 0)    { backend = Backend::Table;    return true; }
+    if (std::strcmp(name, "switch") == 0)   { backend = Backend::Switch;   return true; }
+    if (std::strcmp(name, "threaded") == 0) { backend = Backend::Threaded; return true; }
+    if (std::strcmp(name, "jit") == 0)      { backend = Backend::Jit;      return true; }
+    return false;
+}
+
+/**
+ * @brief Returns whether a pixel is lit in any plane.
+ *
+ * @param video The framebuffer.
+ * @param x The column, in the framebuffer's resolution.
+ * @param y The row, in the framebuffer's resolution.
+ */
+static bool Lit(VideoBuffer const& video, unsigned int x, unsigned int y)
+{
+    unsigned int word = y * video.RowWords() + x / 64;
+    uint64_t bit = 1ull << (63 - x % 64);
+    return ((video.planes[0][word] | video.planes[1][word]) & bit) != 0;
+}
+
+/**
+ * @brief Parses one manifest line.
+ *
+ * @param text The line.
+ * @param entry Receives the entry.
+ * @return true if the line is valid.
+ */
+static bool ParseEntry(std::string const& text, ManifestEntry& entry)
+{
+    entry.text = text;
+
+    std::istringstream tokens(text);
+    std::string token;
+    if (!(tokens >> token) || token[0] == '#') return true;
+
+    entry.isRom = true;
+    entry.rom = token;
+    try
+    {
+        while (tokens >> token)
+        {
+            size_t equals = token.find('=');
+            std::string key = token.substr(0, equals);
+            std::string value = equals == std::string::npos ? std::string() : token.substr(equals + 1);
+
+            if (equals == std::string::npos) entry.golden.push_back(std::stoull(token, nullptr, 16));
+            else if (key == "frames")        entry.frames = std::stoull(value);
+            else if (key == "ipf")           entry.instructionsPerFrame = static_cast<unsigned int>(std::stoul(value));
+            else if (key == "seed")          entry.seed = static_cast<uint32_t>(std::stoul(value));
+            else if (key == "every")         entry.every = std::stoull(value);
+            else if (key == "quirks")        { if (!ParseQuirkProfile(value, entry.quirks)) return false; }
+            else if (key == "movie")         entry.movie = value;
+            else return false;
+        }
+    }
+    catch (std::exception const&)
+    {
+        return false;
+    }
+
+    return entry.frames > 0 && entry.instructionsPerFrame > 0 && entry.every > 0;
+}
+
+/**
+ * @brief Formats an entry as a manifest line with the hashes of its latest run.
+ *
+ * @param entry The entry.
+ * @return The line.
+ */
+static std::string FormatEntry(ManifestEntry const& entry)
+{
+    std::ostringstream line;
+    line << entry.rom << " frames=" << entry.frames << " ipf=" << entry.instructionsPerFrame << " seed=" << entry.seed
+         << " every=" << entry.every;
+    if (entry.quirks != QuirkProfile::Modern) line << " quirks=" << QuirkProfileName(entry.quirks);
+    if (!entry.movie.empty()) line << " movie=" << entry.movie;
+    for (uint64_t hash : entry.hashes)
+    {
+        line << " " << std::hex << std::setw(16) << std::setfill('0') << hash;
+    }
+    return line.str();
+}
+
+/**
+ * @brief Loads an entry's movie, if it has one, and takes the seed, instructions per frame and
+ * quirk profile from it.
+ *
+ * @param entry The entry; receives the error if the movie does not load.
+ * @param directory The directory paths in the manifest are relative to.
+ * @param movie Receives the movie.
+ * @return true if the entry has no movie or it loaded.
+ */
+static bool LoadMovie(ManifestEntry& entry, fs::path const& directory, Movie& movie)
+{
+    if (entry.movie.empty()) return true;
+    if (!movie.Load((directory / entry.movie).string()))
+    {
+        entry.error = "failed to load movie " + entry.movie;
+        return false;
+    }
+    if (movie.InstructionsPerFrame() > 0) entry.instructionsPerFrame = movie.InstructionsPerFrame();
+    entry.seed = movie.Seed();
+    entry.quirks = movie.Quirks();
+    return true;
+}
+
+/**
+ * @brief Runs one ROM, recording the framebuffer and its hash at every checkpoint.
+ *
+ * @param entry The entry to run.
+ * @param directory The directory paths in the manifest are relative to.
+ * @param backend The interpreter backend.
+ */
+static void RunEntry(ManifestEntry& entry, fs::path const& directory, Backend backend)
+{
+    Movie movie(entry.seed, entry.instructionsPerFrame, entry.quirks);
+    if (!LoadMovie(entry, directory, movie)) return;
+
+    Chip8 chip8;
+    chip8.SetQuirks(entry.quirks);
+    chip8.SetBackend(backend);
+    chip8.Seed(entry.seed);
+    if (!chip8.LoadROM((directory / entry.rom).string()))
+    {
+        entry.error = "failed to load ROM";
+        return;
+    }
+
+    for (uint64_t frame = 1; frame <= entry.frames; ++frame)
+    {
+        movie.Play(chip8.keypad);
+        chip8.RunFrame(entry.instructionsPerFrame);
+
+        if (frame % entry.every == 0)
+        {
+            entry.frameBuffers.push_back(chip8.video);
+            entry.hashes.push_back(HashVideo(chip8.video));
+        }
+    }
+}
+
+/**
+ * @brief Runs one ROM on every lane of a lockstep group, recording lane 0's framebuffer and its hash
+ * at every checkpoint.
+ *
+ * Every lane is seeded and driven like the interpreter, so each must draw the golden frames; a lane
+ * whose framebuffer differs from lane 0's is an error. Lanes implement the modern profile only, so
+ * entries for other profiles are skipped.
+ *
+ * @param entry The entry to run.
+ * @param directory The directory paths in the manifest are relative to.
+ */
+static void RunEntryLockstep(ManifestEntry& entry, fs::path const& directory)
+{
+    Movie movie(entry.seed, entry.instructionsPerFrame, entry.quirks);
+    if (!LoadMovie(entry, directory, movie)) return;
+    if (entry.quirks != QuirkProfile::Modern)
+    {
+        entry.skipped = true;
+        return;
+    }
+
+    std::ifstream file(directory / entry.rom, std::ios::binary);
+    std::vector<uint8_t> rom((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    Lockstep<LOCKSTEP_LANES> lockstep;
+    if (!file.is_open() || !lockstep.LoadROM(rom.data(), rom.size()))
+    {
+        entry.error = "failed to load ROM";
+        return;
+    }
+    for (size_t lane = 0; lane < LOCKSTEP_LANES; ++lane) lockstep.Seed(lane, entry.seed);
+
+    std::array<uint8_t, KEY_COUNT> keypad{};
+    for (uint64_t frame = 1; frame <= entry.frames; ++frame)
+    {
+        movie.Play(keypad);
+        for (size_t lane = 0; lane < LOCKSTEP_LANES; ++lane)
+        {
+            for (unsigned int key = 0; key < KEY_COUNT; ++key) lockstep.SetKey(lane, key, keypad[key] != 0);
+        }
+        lockstep.RunFrame(entry.instructionsPerFrame);
+
+        if (frame % entry.every == 0)
+        {
+            VideoBuffer video = lockstep.Video(0);
+            for (size_t lane = 1; lane < LOCKSTEP_LANES; ++lane)
+            {
+                if (HashVideo(lockstep.Video(lane)) != HashVideo(video))
+                {
+                    entry.error = "lane " + std::to_string(lane) + " differs from lane 0 at frame " + std::to_string(frame);
+                    return;
+                }
+            }
+            entry.frameBuffers.push_back(video);
+            entry.hashes.push_back(HashVideo(video));
+        }
+    }
+}
+
+/**
+ * @brief Writes the golden framebuffers of an entry's checkpoints next to its ROM, as <rom>.golden.
+ *
+ * @param entry The entry, after a run.
+ * @param directory The directory paths in the manifest are relative to.
+ * @return true if the file was written.
+ */
+static bool WriteGoldenFrames(ManifestEntry const& entry, fs::path const& directory)
+{
+    std::ofstream file(directory / (entry.rom + ".golden"), std::ios::binary);
+    for (VideoBuffer const& video : entry.frameBuffers)
+    {
+        file.put(video.hires ? 1 : 0);
+        for (VideoBuffer::Plane const& plane : video.planes)
+        {
+            for (uint64_t word : plane)
+            {
+                for (unsigned int i = 0; i < 8; ++i)
+                {
+                    file.put(static_cast<char>(word >> (8 * i)));
+                }
+            }
+        }
+    }
+    return static_cast<bool>(file);
+}
+
+/**
+ * @brief Reads one checkpoint's framebuffer from an entry's golden frames.
+ *
+ * @param entry The entry.
+ * @param directory The directory paths in the manifest are relative to.
+ * @param checkpoint The checkpoint index.
+ * @param video Receives the framebuffer.
+ * @return true if the golden frames have that checkpoint.
+ */
+static bool ReadGoldenFrame(ManifestEntry const& entry, fs::path const& directory, size_t checkpoint, VideoBuffer& video)
+{
+    std::ifstream file(directory / (entry.rom + ".golden"), std::ios::binary);
+    file.seekg(static_cast<std::streamoff>(checkpoint * GOLDEN_FRAME_SIZE));
+
+    uint8_t bytes[GOLDEN_FRAME_SIZE];
+    if (!file.read(reinterpret_cast<char*>(bytes), sizeof(bytes))) return false;
+
+    video.hires = bytes[0] != 0;
+    uint8_t const* in = bytes + 1;
+    for (VideoBuffer::Plane& plane : video.planes)
+    {
+        for (uint64_t& word : plane)
+        {
+            word = 0;
+            for (unsigned int i = 0; i < 8; ++i)
+            {
+                word |= static_cast<uint64_t>(*in++) << (8 * i);
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Writes a diff of two framebuffers as a PPM image.
+ *
+ * Pixels lit in both are white, only in the golden frame red, only in the actual frame green.
+ * Without a golden frame, the actual frame is drawn on its own. The image has the actual frame's
+ * resolution; a golden frame in the other resolution is scaled to it.
+ *
+ * @param path The image file.
+ * @param golden The golden framebuffer, or null.
+ * @param actual The framebuffer of the run.
+ * @return true if the image was written.
+ */
+static bool WriteDiffImage(fs::path const& path, VideoBuffer const* golden, VideoBuffer const& actual)
+{
+    const unsigned int width = actual.Width();
+    const unsigned int height = actual.Height();
+    std::ofstream file(path, std::ios::binary);
+    file << "P6\n" << width * DIFF_SCALE << " " << height * DIFF_SCALE << "\n255\n";
+
+    for (unsigned int y = 0; y < height * DIFF_SCALE; ++y)
+    {
+        for (unsigned int x = 0; x < width * DIFF_SCALE; ++x)
+        {
+            unsigned int column = x / DIFF_SCALE;
+            unsigned int row = y / DIFF_SCALE;
+            bool isActual = Lit(actual, column, row);
+            bool isGolden = golden ? Lit(*golden, column * golden->Width() / width, row * golden->Height() / height) : isActual;
+
+            char pixel[3] = {
+                static_cast<char>(isGolden ? 0xFF : 0x00),
+                static_cast<char>(isActual ? 0xFF : 0x00),
+                static_cast<char>(isGolden && isActual ? 0xFF : 0x00)
+            };
+            file.write(pixel, sizeof(pixel));
+        }
+    }
+    return static_cast<bool>(file);
+}
+
+/**
+ * @brief Entry point for the golden-frame regression runner.
+ *
+ * Runs every ROM in a manifest on a thread pool, hashing the framebuffer at checkpoint frames,
+ * and compares the hashes with the manifest. With --update, the manifest hashes and golden frames
+ * are rewritten from this run instead. With --lockstep, each ROM runs on a Lockstep group instead of
+ * the interpreter, so the lanes are checked against the interpreter's golden frames.
+ *
+ * @param argc The number of command-line arguments.
+ * @param argv The array of command-line arguments.
+ * @return int Returns EXIT_SUCCESS if every ROM matched, or EXIT_FAILURE otherwise.
+ */
+int main(int argc, char** argv)
+{
+    Backend backend = Backend::CHIP8_DEFAULT_BACKEND;
+    unsigned int threads = 0;
+    bool update = false;
+    bool lockstep = false;
+    fs::path diffDirectory = "regress-diff";
+    std::string manifestFilename;
+
+    // Parse command-line arguments
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            threads = static_cast<unsigned int>(std::stoul(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--diff-dir") == 0 && i + 1 < argc)
+        {
+            diffDirectory = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--update") == 0)
+        {
+            update = true;
+        }
+        else if (std::strcmp(argv[i], "--lockstep") == 0)
+        {
+            lockstep = true;
+        }
+        else if (std::strcmp(argv[i], "--backend") == 0 && i + 1 < argc && ParseBackend(argv[i + 1], backend))
+        {
+            ++i;
+        }
+        else if (manifestFilename.empty() && argv[i][0] != '-')
+        {
+            manifestFilename = argv[i];
+        }
+        else
+        {
+            manifestFilename.clear();
+            break;
+        }
+    }
+
+    // Ensure correct usage; golden frames come from the interpreter, so lockstep runs only check them
+    if (manifestFilename.empty() || (lockstep && update))
+    {
+        std::cerr << "Usage: " << argv[0] << " [--update | --lockstep] [--threads <N>] [--backend table|switch|threaded|jit] [--diff-dir <Dir>] <Manifest>\n";
+        return EXIT_FAILURE;
+    }
+
+    std::ifstream manifest(manifestFilename);
+    if (!manifest.is_open())
+    {
+        std::cerr << "Failed to open manifest: " << manifestFilename << "\n";
+        return EXIT_FAILURE;
+    }
+
+    std::vector<ManifestEntry> entries;
+    std::vector<size_t> roms;
+    std::string text;
+    for (size_t line = 1; std::getline(manifest, text); ++line)
+    {
+        entries.emplace_back();
+        if (!ParseEntry(text, entries.back()))
+        {
+            std::cerr << manifestFilename << ":" << line << ": invalid entry\n";
+            return EXIT_FAILURE;
+        }
+        if (entries.back().isRom) roms.push_back(entries.size() - 1);
+    }
+    manifest.close();
+
+    fs::path directory = fs::path(manifestFilename).parent_path();
+
+    // ROMs are independent, so they spread over every core; the pool balances long and short runs
+    ThreadPool pool(threads);
+    auto startTime = std::chrono::steady_clock::now();
+    pool.ParallelFor(roms.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+        {
+            if (lockstep) RunEntryLockstep(entries[roms[i]], directory);
+            else RunEntry(entries[roms[i]], directory, backend);
+        }
+    });
+    auto endTime = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(endTime - startTime).count();
+
+    size_t failures = 0;
+    size_t skipped = 0;
+    for (size_t i : roms)
+    {
+        ManifestEntry const& entry = entries[i];
+        if (!entry.error.empty())
+        {
+            std::cout << "ERROR " << entry.rom << ": " << entry.error << "\n";
+            ++failures;
+        }
+        else if (entry.skipped)
+        {
+            std::cout << "SKIP  " << entry.rom << ": lockstep lanes run the modern profile only\n";
+            ++skipped;
+        }
+        else if (update)
+        {
+            if (!WriteGoldenFrames(entry, directory))
+            {
+                std::cout << "ERROR " << entry.rom << ": failed to write golden frames\n";
+                ++failures;
+            }
+        }
+        else if (entry.golden != entry.hashes)
+        {
+            // Report the first checkpoint that differs, with an image of how
+            size_t checkpoint = 0;
+            while (checkpoint < entry.golden.size() && checkpoint < entry.hashes.size()
+                   && entry.golden[checkpoint] == entry.hashes[checkpoint]) ++checkpoint;
+
+            std::cout << "FAIL  " << entry.rom;
+            if (checkpoint < entry.golden.size() && checkpoint < entry.hashes.size())
+            {
+                VideoBuffer golden;
+                bool hasGolden = ReadGoldenFrame(entry, directory, checkpoint, golden);
+                fs::path image = diffDirectory / (std::to_string(i + 1) + "-" + fs::path(entry.rom).stem().string()
+                                                  + "-" + std::to_string((checkpoint + 1) * entry.every) + ".ppm");
+
+                std::error_code error;
+                fs::create_directories(diffDirectory, error);
+                std::cout << ": frame " << (checkpoint + 1) * entry.every << " hash " << std::hex << std::setw(16)
+                          << std::setfill('0') << entry.hashes[checkpoint] << ", expected " << std::setw(16)
+                          << entry.golden[checkpoint] << std::dec;
+                if (WriteDiffImage(image, hasGolden ? &golden : nullptr, entry.frameBuffers[checkpoint]))
+                {
+                    std::cout << " (" << (hasGolden ? "diff" : "frame") << ": " << image.string() << ")";
+                }
+            }
+            else
+            {
+                std::cout << ": " << entry.hashes.size() << " checkpoints, expected " << entry.golden.size();
+            }
+            std::cout << "\n";
+            ++failures;
+        }
+    }
+
+    if (update)
+    {
+        std::ofstream out(manifestFilename);
+        for (ManifestEntry const& entry : entries)
+        {
+            out << (entry.isRom ? FormatEntry(entry) : entry.text) << "\n";
+        }
+        if (!out)
+        {
+            std::cerr << "Failed to write manifest: " << manifestFilename << "\n";
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::cout << roms.size() - skipped - failures << "/" << roms.size() - skipped << " ROMs " << (update ? "updated" : "passed")
+              << " in " << seconds << " s on " << pool.ThreadCount() << " threads";
+    if (skipped > 0) std::cout << ", " << skipped << " skipped";
+    std::cout << "\n";
+
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,263 @@
+#include "../include/Rewind.hpp"
+#include <algorithm>
+#include <cstdint>
+
+namespace
+{
+	// A delta is a sequence of runs: 16-bit count of unchanged bytes, 16-bit count of changed
+	// bytes, then the changed bytes XORed with the reference state. Counts are little-endian.
+	constexpr size_t RUN_HEADER_SIZE = 4;
+
+	// Longest run a header can count; longer ones are split
+	constexpr size_t MAX_RUN = UINT16_MAX;
+
+	// Unchanged bytes that end a run of changed ones; shorter gaps are cheaper to store as changes
+	constexpr size_t MIN_UNCHANGED_RUN = RUN_HEADER_SIZE;
+
+	// Keyframes are encoded against an all-zero state, which most of a mostly unused memory
+	// matches; one that does not compress is stored raw, as a record the size of the state
+	const SaveStateBuffer ZERO_STATE{};
+}
+
+/**
+ * @brief Allocates the history, splitting the budget between the frame index and the frame records.
+ *
+ * The three fixed state buffers come out of the budget first.
+ *
+ * @param budget Bytes of memory for the history, clamped to between the buffers plus four save states and 4 GiB.
+ * @param keyframeInterval Frames between keyframes.
+ */
+Rewind::Rewind(size_t budget, unsigned int keyframeInterval)
+	: keyframeInterval(std::max(keyframeInterval, 1u))
+{
+	const size_t buffers = sizeof(keyframeState) + sizeof(scratch) + sizeof(delta);
+	budget = std::min<size_t>(std::max<size_t>(budget, buffers + 4 * XO_SAVE_STATE_SIZE), UINT32_MAX) - buffers;
+	entries.resize(budget / REWIND_BYTES_PER_FRAME);
+	ring.resize(budget - entries.size() * sizeof(Entry));
+}
+
+/**
+ * @brief Records the state of a machine as a keyframe or as a delta against the newest keyframe.
+ *
+ * Deltas larger than half a state are stored as keyframes instead. A machine whose save states
+ * changed size, because it switched profiles, starts a new history.
+ *
+ * @param chip8 The machine.
+ */
+void Rewind::Push(Chip8 const& chip8)
+{
+	if (chip8.SaveStateSize() != stateSize)
+	{
+		Clear();
+		stateSize = chip8.SaveStateSize();
+	}
+	chip8.SaveState(scratch.data(), scratch.size());
+
+	uint64_t frame = first + count;
+	bool isKeyframe = count == 0 || keyframe < first || frame - keyframe >= keyframeInterval;
+	size_t size = isKeyframe ? 0 : Encode(scratch, keyframeState, delta.data(), stateSize / 2);
+	if (size == 0) isKeyframe = true;
+	if (isKeyframe) size = EncodeKeyframe();
+
+	// Making room can drop the keyframe a delta refers to; store a keyframe then
+	size_t offset = Allocate(size);
+	if (!isKeyframe && keyframe < first)
+	{
+		isKeyframe = true;
+		size = EncodeKeyframe();
+		offset = Allocate(size);
+	}
+
+	// The frame count only changes after Allocate(), which may drop frames from the front
+	frame = first + count;
+	std::copy_n(size == stateSize ? scratch.data() : delta.data(), size, ring.begin() + offset);
+	At(frame) = Entry{isKeyframe ? frame : keyframe, static_cast<uint32_t>(offset), static_cast<uint32_t>(size)};
+	++count;
+	used += size;
+
+	if (isKeyframe)
+	{
+		keyframe = frame;
+		keyframeState = scratch;
+	}
+}
+
+/**
+ * @brief Drops the newest frame and restores the one before it.
+ *
+ * @param chip8 The machine to restore.
+ * @return false if there is no earlier frame.
+ */
+bool Rewind::StepBack(Chip8& chip8)
+{
+	if (count < 2) return false;
+
+	--count;
+	used -= At(first + count).size;
+
+	// Dropping a keyframe makes the previous one current again
+	uint64_t frame = first + count - 1;
+	if (At(frame).keyframe != keyframe)
+	{
+		keyframe = At(frame).keyframe;
+		Decode(keyframe, keyframeState);
+	}
+
+	Decode(frame, scratch);
+	return chip8.LoadState(scratch.data(), scratch.size());
+}
+
+/**
+ * @brief Drops the whole history.
+ */
+void Rewind::Clear()
+{
+	first += count;
+	count = 0;
+	used = 0;
+}
+
+/**
+ * @brief Returns where a record can be written, dropping the oldest frames until it fits.
+ *
+ * Records are contiguous: the free space is after the newest record and, once that reaches
+ * the end of the ring, from the start of the ring up to the oldest record.
+ *
+ * @param size The size of the record.
+ * @return The offset of the record in the ring.
+ */
+size_t Rewind::Allocate(size_t size)
+{
+	for (; count > 0; DropOldest())
+	{
+		if (count == entries.size()) continue;
+
+		Entry const& oldest = At(first);
+		Entry const& newest = At(first + count - 1);
+		size_t head = oldest.offset;
+		size_t tail = newest.offset + newest.size;
+
+		if (newest.offset >= oldest.offset)
+		{
+			if (tail + size <= ring.size()) return tail;
+			if (size <= head) return 0;
+		}
+		else if (tail + size <= head)
+		{
+			return tail;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Drops the oldest frame. If it was a keyframe, the deltas encoded against it go too.
+ */
+void Rewind::DropOldest()
+{
+	do
+	{
+		used -= At(first).size;
+		++first;
+		--count;
+	} while (count > 0 && At(first).keyframe != first);
+}
+
+/**
+ * @brief Encodes the scratch state as a keyframe into the delta buffer.
+ *
+ * @return The size of the record: the state size if it did not compress, and the scratch state is stored as is.
+ */
+size_t Rewind::EncodeKeyframe()
+{
+	size_t size = Encode(scratch, ZERO_STATE, delta.data(), stateSize - 1);
+	return size == 0 ? stateSize : size;
+}
+
+/**
+ * @brief Encodes a state as runs of bytes XORed with a reference state.
+ *
+ * @param state The state to encode.
+ * @param reference The state the runs are relative to.
+ * @param out Receives the delta.
+ * @param limit The largest delta to produce.
+ * @return The size of the delta, or 0 if it would be larger than the limit.
+ */
+size_t Rewind::Encode(SaveStateBuffer const& state, SaveStateBuffer const& reference, uint8_t* out, size_t limit) const
+{
+	size_t size = 0;
+	size_t pos = 0;
+
+	while (pos < stateSize)
+	{
+		size_t skip = pos;
+		while (pos < stateSize && pos - skip < MAX_RUN && state[pos] == reference[pos]) ++pos;
+		size_t unchanged = pos - skip;
+
+		// Changed bytes run until MIN_UNCHANGED_RUN unchanged ones in a row, the longest run, or the end
+		size_t start = pos;
+		size_t end = pos;
+		for (size_t same = 0; pos < stateSize && pos - start < MAX_RUN && same < MIN_UNCHANGED_RUN; ++pos)
+		{
+			if (state[pos] == reference[pos])
+			{
+				++same;
+			}
+			else
+			{
+				same = 0;
+				end = pos + 1;
+			}
+		}
+		pos = end;
+
+		size_t changed = end - start;
+		if (size + RUN_HEADER_SIZE + changed > limit) return 0;
+
+		out[size++] = static_cast<uint8_t>(unchanged);
+		out[size++] = static_cast<uint8_t>(unchanged >> 8);
+		out[size++] = static_cast<uint8_t>(changed);
+		out[size++] = static_cast<uint8_t>(changed >> 8);
+		for (size_t i = start; i < end; ++i)
+		{
+			out[size++] = state[i] ^ reference[i];
+		}
+	}
+
+	return size;
+}
+
+/**
+ * @brief Rebuilds a frame's state: its keyframe record applied to a zero state (or copied, if stored raw),
+ * otherwise its delta applied to the current keyframe, which must be the one it was encoded against.
+ *
+ * @param frame The frame.
+ * @param state Receives the state.
+ */
+void Rewind::Decode(uint64_t frame, SaveStateBuffer& state)
+{
+	Entry const& entry = At(frame);
+	uint8_t const* in = ring.data() + entry.offset;
+	uint8_t const* end = in + entry.size;
+
+	if (entry.keyframe == frame && entry.size == stateSize)
+	{
+		std::copy(in, end, state.begin());
+		return;
+	}
+
+	if (entry.keyframe == frame) state.fill(0);
+	else state = keyframeState;
+	for (size_t pos = 0; in < end;)
+	{
+		size_t unchanged = in[0] | (in[1] << 8u);
+		size_t changed = in[2] | (in[3] << 8u);
+		in += RUN_HEADER_SIZE;
+		pos += unchanged;
+		for (size_t i = 0; i < changed; ++i)
+		{
+			state[pos++] ^= *in++;
+		}
+	}
+}
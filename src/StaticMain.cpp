@@ -0,0 +1,106 @@
+#include "../include/Chip8.hpp"
+#include "../include/StaticProgram.hpp"
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Instructions executed per emulated 60 Hz frame
+constexpr unsigned int DEFAULT_INSTRUCTIONS_PER_FRAME = 10;
+
+// The ROM and its recompiled blocks, defined by the translation unit chip8-recompile generated
+extern const StaticProgram staticProgram;
+
+/**
+ * @brief Entry point for a ROM-specific executable built from a statically recompiled ROM.
+ *
+ * Runs the embedded ROM headless for a number of frames at full host speed, then reports
+ * the wall time and instructions per second, like chip8-headless. With --every, it also
+ * prints the framebuffer hash every N frames, as golden-frame manifests record them.
+ *
+ * @param argc The number of command-line arguments.
+ * @param argv The array of command-line arguments.
+ * @return int Returns EXIT_SUCCESS on successful execution, or EXIT_FAILURE on error.
+ */
+int main(int argc, char** argv)
+{
+    uint64_t frames = 0;
+    unsigned int instructionsPerFrame = DEFAULT_INSTRUCTIONS_PER_FRAME;
+    uint64_t every = 0;
+    uint32_t seed = 0;
+    bool seeded = false;
+    bool interpret = false;
+
+    // Parse command-line arguments
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+        {
+            frames = std::stoull(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--ipf") == 0 && i + 1 < argc)
+        {
+            instructionsPerFrame = static_cast<unsigned int>(std::stoul(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--every") == 0 && i + 1 < argc)
+        {
+            every = std::stoull(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+        {
+            seed = static_cast<uint32_t>(std::stoul(argv[++i]));
+            seeded = true;
+        }
+        else if (std::strcmp(argv[i], "--interpret") == 0)
+        {
+            interpret = true;
+        }
+        else
+        {
+            frames = 0;
+            break;
+        }
+    }
+
+    // Ensure correct usage
+    if (frames == 0 || instructionsPerFrame == 0)
+    {
+        std::cerr << "Usage: " << argv[0] << " --frames <N> [--ipf <N>] [--seed <N>] [--every <N>] [--interpret]\n";
+        return EXIT_FAILURE;
+    }
+
+    Chip8 chip8;
+    chip8.SetQuirks(staticProgram.quirks);
+    if (seeded) chip8.Seed(seed);
+    chip8.LoadROM(staticProgram.rom, staticProgram.romSize);
+    if (!interpret) chip8.SetStaticProgram(staticProgram);
+
+    std::vector<uint64_t> hashes;
+    auto startTime = std::chrono::steady_clock::now();
+    for (uint64_t frame = 1; frame <= frames; ++frame)
+    {
+        chip8.RunFrame(instructionsPerFrame);
+        if (every != 0 && frame % every == 0) hashes.push_back(HashVideo(chip8.video));
+    }
+    auto endTime = std::chrono::steady_clock::now();
+
+    double seconds = std::chrono::duration<double>(endTime - startTime).count();
+
+    std::cout << "instructions: " << chip8.InstructionCount() << "\n";
+    std::cout << "skipped idle cycles: " << chip8.SkippedCycleCount() << "\n";
+    std::cout << "frames: " << frames << "\n";
+    std::cout << "wall time: " << seconds << " s\n";
+    std::cout << "instructions/s: " << (seconds > 0.0 ? static_cast<double>(chip8.InstructionCount()) / seconds : 0.0) << "\n";
+    if (every != 0)
+    {
+        std::cout << "hashes:" << std::hex << std::setfill('0');
+        for (uint64_t hash : hashes) std::cout << " " << std::setw(16) << hash;
+        std::cout << std::dec << "\n";
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,85 @@
+#include "../include/StaticProgram.hpp"
+#include <cstring>
+
+/**
+ * @brief Attaches a recompiled program to a machine.
+ *
+ * @param program The recompiled program.
+ * @param chip8 The machine it will run on, whose memory is checked against the program's ROM.
+ */
+StaticRunner::StaticRunner(StaticProgram const& program, Chip8 const& chip8)
+	: program(program), blockAt(MemorySizeOf(program.quirks), -1)
+{
+	Validate(chip8, 0, MemorySizeOf(program.quirks));
+}
+
+/**
+ * @brief Executes exactly a number of CPU cycles, entering recompiled blocks wherever pc lands on one.
+ *
+ * @param chip8 The machine to run.
+ * @param cycles The number of instructions to execute.
+ * @return The cycles not executed: those an idle-loop skip ran off, or the rest once Fx0A halts.
+ */
+unsigned int StaticRunner::Run(Chip8& chip8, unsigned int cycles)
+{
+	while (cycles > 0)
+	{
+		int32_t block = blockAt[chip8.pc & (blockAt.size() - 1)];
+
+		if (block >= 0)
+		{
+			cycles = program.blocks[block].run(chip8, cycles);
+		}
+		else
+		{
+			chip8.Cycle();
+			--cycles;
+		}
+		// Fx0A ends every block, so a halt is seen right after the block that hit it
+		if (chip8.waitingForKey) return cycles;
+
+		// Blocks end at jumps, so an idle loop is seen as soon as pc enters it
+		if (chip8.SkipIdleLoop(cycles)) return cycles;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Re-checks the blocks overlapping memory that was just written.
+ *
+ * @param chip8 The machine whose memory was written.
+ * @param address The first address written.
+ * @param length The number of bytes written.
+ */
+void StaticRunner::Invalidate(Chip8 const& chip8, unsigned int address, unsigned int length)
+{
+	Validate(chip8, address, length);
+}
+
+/**
+ * @brief Enables each block overlapping a range whose memory still matches the ROM, and disables the others.
+ *
+ * Comparing against the ROM rather than just dropping blocks means reloading the same ROM,
+ * or a store that writes back identical bytes, keeps the recompiled code in use. A machine
+ * whose quirks differ from the program's uses none of it.
+ *
+ * @param chip8 The machine whose memory is checked.
+ * @param address The first address of the range.
+ * @param length The length of the range in bytes.
+ */
+void StaticRunner::Validate(Chip8 const& chip8, unsigned int address, unsigned int length)
+{
+	unsigned int end = address + length;
+
+	for (size_t i = 0; i < program.blockCount; ++i)
+	{
+		StaticBlock const& block = program.blocks[i];
+		if (address >= block.end || end <= block.start) continue;
+
+		bool matches = chip8.quirkProfile == program.quirks && block.end <= START_ADDRESS + program.romSize
+			&& std::memcmp(chip8.Memory() + block.start, program.rom + (block.start - START_ADDRESS), block.end - block.start) == 0;
+
+		blockAt[block.start] = matches ? static_cast<int32_t>(i) : -1;
+	}
+}
@@ -0,0 +1,149 @@
+#include "../include/ThreadPool.hpp"
+#include <algorithm>
+
+/**
+ * @brief Starts the worker threads.
+ *
+ * @param threadCount The number of threads running loops, including the caller; 0 uses every hardware thread.
+ */
+ThreadPool::ThreadPool(unsigned int threadCount)
+{
+	if (threadCount == 0)
+	{
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	for (unsigned int i = 0; i < threadCount; ++i)
+	{
+		queues.push_back(std::make_unique<Queue>());
+	}
+
+	// The caller is worker 0, so only the rest need threads
+	for (unsigned int i = 1; i < threadCount; ++i)
+	{
+		threads.emplace_back(&ThreadPool::WorkerLoop, this, i);
+	}
+}
+
+/**
+ * @brief Stops and joins the worker threads.
+ */
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+}
+
+/**
+ * @brief Calls body(begin, end) over disjoint ranges covering [0, count) and returns once all have finished.
+ *
+ * @param count The number of indices.
+ * @param body The function run on each range.
+ */
+void ThreadPool::ParallelFor(size_t count, std::function<void(size_t begin, size_t end)> const& body)
+{
+	if (count == 0) return;
+
+	const size_t workers = queues.size();
+	const size_t chunk = std::max<size_t>(1, count / (workers * CHUNKS_PER_WORKER));
+	const size_t chunks = (count + chunk - 1) / chunk;
+
+	// Deal contiguous runs of chunks to each worker so neighbouring indices stay on one core
+	pending.store(chunks);
+	for (size_t i = 0; i < chunks; ++i)
+	{
+		Queue& queue = *queues[i * workers / chunks];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.ranges.push_back(Range{i * chunk, std::min(count, (i + 1) * chunk), &body});
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		++generation;
+	}
+	wake.notify_all();
+
+	while (RunOne(0))
+	{
+	}
+
+	std::unique_lock<std::mutex> lock(mutex);
+	done.wait(lock, [this] { return pending.load() == 0; });
+}
+
+/**
+ * @brief Waits for loops to start and works on them until the pool is destroyed.
+ *
+ * @param worker This thread's queue index.
+ */
+void ThreadPool::WorkerLoop(unsigned int worker)
+{
+	uint64_t seen = 0;
+
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [&] { return stopping || generation != seen; });
+			if (stopping) return;
+			seen = generation;
+		}
+
+		while (RunOne(worker))
+		{
+		}
+	}
+}
+
+/**
+ * @brief Runs one range from this worker's queue, or steals one from another worker.
+ *
+ * @param worker This thread's queue index.
+ * @return false if every queue was empty.
+ */
+bool ThreadPool::RunOne(unsigned int worker)
+{
+	const size_t workers = queues.size();
+	Range range{};
+	bool found = false;
+
+	for (size_t i = 0; i < workers && !found; ++i)
+	{
+		Queue& queue = *queues[(worker + i) % workers];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.ranges.empty()) continue;
+
+		if (i == 0)
+		{
+			range = queue.ranges.back();
+			queue.ranges.pop_back();
+		}
+		else
+		{
+			range = queue.ranges.front();
+			queue.ranges.pop_front();
+		}
+		found = true;
+	}
+
+	if (!found) return false;
+
+	(*range.body)(range.begin, range.end);
+
+	if (pending.fetch_sub(1) == 1)
+	{
+		// Take the lock so the caller cannot miss the notification between its check and its wait
+		std::lock_guard<std::mutex> lock(mutex);
+		done.notify_all();
+	}
+
+	return true;
+}
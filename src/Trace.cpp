@@ -0,0 +1,176 @@
+#include "../include/Chip8.hpp"
+#include "../include/Tracer.hpp"
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Records read from the file at a time
+constexpr size_t READ_CHUNK = 4096;
+
+// Which records to print
+struct Filter
+{
+    unsigned int firstPc = 0;           // Lowest address printed
+    unsigned int lastPc = 0xFFFF;       // Highest address printed
+    std::string mnemonic;               // Instruction name printed (e.g. DRW), empty for any
+    int reg = -1;                       // Register an instruction must change to be printed, -1 for any
+    uint64_t skip = 0;                  // Executed instructions passed over first
+    uint64_t count = UINT64_MAX;        // Records printed at most
+};
+
+/**
+ * @brief Parses an address range given as "<lo>" or "<lo>-<hi>", hexadecimal.
+ *
+ * @param text The range.
+ * @param filter Receives the range.
+ * @return true if the range is valid.
+ */
+static bool ParseRange(std::string const& text, Filter& filter)
+{
+    size_t dash = text.find('-');
+    filter.firstPc = static_cast<unsigned int>(std::stoul(text.substr(0, dash), nullptr, 16));
+    filter.lastPc = dash == std::string::npos ? filter.firstPc : static_cast<unsigned int>(std::stoul(text.substr(dash + 1), nullptr, 16));
+    return filter.firstPc <= filter.lastPc;
+}
+
+/**
+ * @brief Prints one record as its sequence number, address, opcode, disassembly, I and changed registers.
+ *
+ * @param sequence The number of instructions executed before it.
+ * @param record The record.
+ */
+static void PrintRecord(uint64_t sequence, TraceRecord const& record)
+{
+    std::string text = Disassemble(record.opcode);
+
+    std::cout << std::dec << std::setfill(' ') << std::setw(12) << sequence << std::hex << std::uppercase << std::setfill('0')
+              << "  0x" << std::setw(3) << record.pc << "  " << std::setw(4) << record.opcode << "  "
+              << std::left << std::setfill(' ') << std::setw(18) << text << std::right << std::setfill('0')
+              << "  I=0x" << std::setw(3) << record.index;
+
+    unsigned int shown = 0;
+    for (unsigned int reg = 0; reg < REGISTER_COUNT; ++reg)
+    {
+        if (!(record.changed & (1u << reg))) continue;
+        std::cout << "  V" << reg << "=" << std::setw(2) << static_cast<unsigned int>(record.values[shown++]);
+    }
+    std::cout << std::dec << std::nouppercase << "\n";
+}
+
+/**
+ * @brief Entry point for the trace decoder.
+ *
+ * Reads a trace written by chip8-headless or the windowed emulator with --trace and prints
+ * the records that pass the filters, disassembled.
+ *
+ * @param argc The number of command-line arguments.
+ * @param argv The array of command-line arguments.
+ * @return int Returns EXIT_SUCCESS on successful execution, or EXIT_FAILURE on error.
+ */
+int main(int argc, char** argv)
+{
+    Filter filter;
+    std::string traceFilename;
+    bool valid = true;
+
+    // Parse command-line arguments
+    for (int i = 1; i < argc && valid; ++i)
+    {
+        if (std::strcmp(argv[i], "--pc") == 0 && i + 1 < argc)
+        {
+            valid = ParseRange(argv[++i], filter);
+        }
+        else if (std::strcmp(argv[i], "--op") == 0 && i + 1 < argc)
+        {
+            filter.mnemonic = argv[++i];
+            for (char& c : filter.mnemonic) c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+        }
+        else if (std::strcmp(argv[i], "--reg") == 0 && i + 1 < argc)
+        {
+            filter.reg = static_cast<int>(std::stoul(argv[++i], nullptr, 16));
+            valid = filter.reg < static_cast<int>(REGISTER_COUNT);
+        }
+        else if (std::strcmp(argv[i], "--skip") == 0 && i + 1 < argc)
+        {
+            filter.skip = std::stoull(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--count") == 0 && i + 1 < argc)
+        {
+            filter.count = std::stoull(argv[++i]);
+        }
+        else if (traceFilename.empty() && argv[i][0] != '-')
+        {
+            traceFilename = argv[i];
+        }
+        else
+        {
+            valid = false;
+        }
+    }
+
+    if (!valid || traceFilename.empty())
+    {
+        std::cerr << "Usage: " << argv[0] << " [--pc <Lo>[-<Hi>]] [--op <Mnemonic>] [--reg <X>] [--skip <N>] [--count <N>] <Trace>\n";
+        return EXIT_FAILURE;
+    }
+
+    // Check the header: magic, format version and record size
+    std::ifstream file(traceFilename, std::ios::binary);
+    uint8_t header[12] = {};
+    file.read(reinterpret_cast<char*>(header), sizeof(header));
+    auto word = [&](unsigned int offset) {
+        return header[offset] | (header[offset + 1] << 8u) | (header[offset + 2] << 16u) | (static_cast<uint32_t>(header[offset + 3]) << 24u);
+    };
+    if (!file || std::memcmp(header, "C8TR", 4) != 0 || word(4) != TRACE_VERSION || word(8) != sizeof(TraceRecord))
+    {
+        std::cerr << "Not a trace: " << traceFilename << "\n";
+        return EXIT_FAILURE;
+    }
+
+    // Sequence numbers count executed instructions, including those a gap stands for
+    uint64_t sequence = 0;
+    uint64_t printed = 0;
+    std::vector<TraceRecord> records(READ_CHUNK);
+    while (printed < filter.count && file)
+    {
+        file.read(reinterpret_cast<char*>(records.data()), static_cast<std::streamsize>(records.size() * sizeof(TraceRecord)));
+        size_t read = static_cast<size_t>(file.gcount()) / sizeof(TraceRecord);
+
+        for (size_t i = 0; i < read && printed < filter.count; ++i)
+        {
+            TraceRecord const& record = records[i];
+            if (record.pc == TRACE_GAP)
+            {
+                uint64_t dropped = 0;
+                std::memcpy(&dropped, record.values.data(), sizeof(dropped));
+                if (sequence + dropped > filter.skip)
+                {
+                    std::cout << std::setfill(' ') << std::setw(12) << sequence << "  ... " << dropped << " instructions not recorded\n";
+                    ++printed;
+                }
+                sequence += dropped;
+                continue;
+            }
+
+            uint64_t current = sequence++;
+            if (current < filter.skip || record.pc < filter.firstPc || record.pc > filter.lastPc) continue;
+            if (filter.reg >= 0 && !(record.changed & (1u << filter.reg))) continue;
+            if (!filter.mnemonic.empty())
+            {
+                std::string text = Disassemble(record.opcode);
+                if (text.compare(0, text.find(' '), filter.mnemonic) != 0) continue;
+            }
+
+            PrintRecord(current, record);
+            ++printed;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,110 @@
+#include "../include/Tracer.hpp"
+#include <chrono>
+
+constexpr std::chrono::milliseconds TRACE_POLL_INTERVAL{2};   // Time the writer sleeps when the ring is empty
+
+/**
+ * @brief Allocates a ring of at least the given number of records.
+ *
+ * @param capacity The number of records held, rounded up to a power of two.
+ */
+TraceRing::TraceRing(size_t capacity)
+{
+	size_t size = 1;
+	while (size < capacity) size <<= 1;
+
+	slots.resize(size);
+	mask = size - 1;
+}
+
+/**
+ * @brief Binds the writer to a ring; nothing is written until Open().
+ *
+ * @param ring The ring to read.
+ */
+TraceWriter::TraceWriter(TraceRing& ring)
+	: ring(ring)
+{
+}
+
+/**
+ * @brief Writes what is left in the ring and closes the file.
+ */
+TraceWriter::~TraceWriter()
+{
+	Close();
+}
+
+/**
+ * @brief Creates the trace file, writes its header and starts the writer thread.
+ *
+ * @param filename The file to write.
+ * @return true if the file was created.
+ */
+bool TraceWriter::Open(std::string const& filename)
+{
+	if (running.load()) return false;
+
+	file.open(filename, std::ios::binary | std::ios::trunc);
+	if (!file) return false;
+
+	uint8_t header[12] = {'C', '8', 'T', 'R'};
+	for (unsigned int i = 0; i < 4; ++i)
+	{
+		header[4 + i] = static_cast<uint8_t>(TRACE_VERSION >> (8 * i));
+		header[8 + i] = static_cast<uint8_t>(sizeof(TraceRecord) >> (8 * i));
+	}
+	file.write(reinterpret_cast<char const*>(header), sizeof(header));
+
+	running.store(true);
+	thread = std::thread(&TraceWriter::Run, this);
+	return static_cast<bool>(file);
+}
+
+/**
+ * @brief Stops the writer thread, writes every record published so far and closes the file.
+ *
+ * @return true if everything was written.
+ */
+bool TraceWriter::Close()
+{
+	if (!file.is_open()) return true;
+
+	running.store(false);
+	if (thread.joinable()) thread.join();
+
+	Drain();
+	file.close();
+	return !file.fail();
+}
+
+/**
+ * @brief Writes records as they are published, sleeping briefly whenever the ring is empty.
+ */
+void TraceWriter::Run()
+{
+	while (running.load(std::memory_order_relaxed))
+	{
+		size_t count = 0;
+		ring.Peek(count);
+		if (count == 0)
+		{
+			std::this_thread::sleep_for(TRACE_POLL_INTERVAL);
+			continue;
+		}
+		Drain();
+	}
+}
+
+/**
+ * @brief Writes every record available now, straight from the ring's memory.
+ */
+void TraceWriter::Drain()
+{
+	size_t count = 0;
+	for (TraceRecord const* records = ring.Peek(count); count != 0; records = ring.Peek(count))
+	{
+		file.write(reinterpret_cast<char const*>(records), static_cast<std::streamsize>(count * sizeof(TraceRecord)));
+		ring.Consume(count);
+	}
+}
@@ -0,0 +1,250 @@
+#!/usr/bin/env python3
+"""Writes the hand-assembled ROMs of the golden-frame corpus (golden.txt) into this directory.
+
+Each ROM runs a series of tests and, after each, calls DUMP, which draws V0-VC and VF as one 8x14
+sprite, one row per register, so the framebuffer hashes cover every register the tests use.
+VD and VE hold DUMP's cursor, and VF comes back with the draw's collision flag. Sixteen dumps fill
+the 64x32 display.
+
+Run it after changing a listing, then refresh the hashes with chip8-regress --update golden.txt.
+"""
+
+import os
+import struct
+
+SCRATCH = 0xF00         # DUMP's register image
+DATA = 0xF22            # Memory the tests read and write; low nibble 2, so 0nnn at DATA does nothing
+
+
+class Rom:
+    def __init__(self):
+        self.words = []
+        self.labels = {}
+        self.fixups = []
+
+    def __call__(self, *words):
+        self.words.extend(words)
+
+    def label(self, name):
+        self.labels[name] = 0x200 + 2 * len(self.words)
+
+    def ref(self, high, name):
+        """An instruction whose low 12 bits are the address of a label, e.g. ref(0x2000, "DUMP")."""
+        self.fixups.append((len(self.words), high, name))
+        self.words.append(0)
+
+    def dump(self):
+        self.ref(0x2000, "DUMP")
+
+    def build(self):
+        # DUMP: store V0-VF, move VF over VD's byte, draw V0-VC and VF at (VD, VE), advance the
+        # cursor eight columns, wrapping to the next band
+        self.label("DUMP")
+        self(0xA000 | SCRATCH, 0xFF55,          # LD I, SCRATCH; LD [I], VF
+             0xA000 | (SCRATCH + 15), 0xF065,   # LD V0, [SCRATCH + 15]
+             0xA000 | (SCRATCH + 13), 0xF055,   # LD [SCRATCH + 13], V0
+             0xA000 | SCRATCH, 0xF065,          # V0 back
+             0xA000 | SCRATCH, 0xDDEE,          # LD I, SCRATCH; DRW VD, VE, 14
+             0x7D08, 0x3D40, 0x00EE,            # ADD VD, 8; SE VD, 64; RET
+             0x6D00, 0x7E10, 0x00EE)            # LD VD, 0; ADD VE, 16; RET
+        for index, high, name in self.fixups:
+            self.words[index] = high | self.labels[name]
+        return b"".join(struct.pack(">H", word) for word in self.words)
+
+
+def finish(rom):
+    rom.label("END")
+    rom.ref(0x1000, "END")                      # JP END
+
+
+def alu():
+    """6xkk, 7xkk, the 8xyn table including the unused 8xy8-8xyD and 8xyF, Cxkk, Annn, Fx1E, Fx29, Fx33, Fx55, Fx65."""
+    rom = Rom()
+    rom(0x6D00, 0x6E00)
+    rom(0x6012, 0x70FF, 0x61F0, 0x7110,         # V0 = 0x12 + 0xFF, V1 = 0xF0 + 0x10: 7xkk wraps, VF untouched
+        0x625A, 0x63C3, 0x8420, 0x8530,         # LD V4, V2; LD V5, V3
+        0x6F07, 0x8521, 0x6655, 0x8632,         # OR, AND, XOR: resetVF clears VF on the COSMAC VIP
+        0x6755, 0x8733)
+    rom.dump()
+    rom(0x60F0, 0x6120, 0x8014)                 # ADD with carry
+    rom.dump()
+    rom(0x6010, 0x6120, 0x8014)                 # ADD without carry
+    rom.dump()
+    rom(0x6010, 0x6120, 0x8015)                 # SUB with borrow
+    rom.dump()
+    rom(0x6030, 0x6120, 0x8015)                 # SUB without borrow
+    rom.dump()
+    rom(0x6005, 0x6181, 0x8016)                 # SHR: V0 in place, or Vy on the COSMAC VIP and XO-CHIP
+    rom.dump()
+    rom(0x6010, 0x6120, 0x8017)                 # SUBN
+    rom.dump()
+    rom(0x6081, 0x6105, 0x801E)                 # SHL
+    rom.dump()
+    rom(0x6011, 0x6122, 0x6233, 0x6344, 0x6455,
+        0x8018, 0x8119, 0x821A, 0x831B,         # 8xy8-8xyB: no instruction, registers unchanged
+        0x841C, 0x801D, 0x810F, 0x8FFF)         # 8xyC, 8xyD, 8xyF, 8FFF: likewise
+    rom.dump()
+    rom(0x6FF0, 0x6120, 0x8F14)                 # ADD VF, V1: VF ends with the flag
+    rom.dump()
+    rom(0xC0FF, 0xC17F, 0xC20F, 0xC300)         # RND under the manifest seed
+    rom.dump()
+    rom(0xA000 | DATA, 0x60EA, 0xF033,          # LD B, V0 (234)
+        0xA000 | DATA, 0xF265)                  # LD V2, [I]
+    rom.dump()
+    rom(0xA000 | DATA, 0x6004, 0xF01E,          # ADD I, V0
+        0x6077, 0xF055,                         # LD [I], V0 at DATA + 4
+        0xA000 | DATA, 0xF365)                  # V0-V3 = 2, 3, 4, 0x77
+    rom.dump()
+    rom(0x600A, 0xF029, 0xF465)                 # LD F, V0: the first rows of digit A
+    rom.dump()
+    finish(rom)
+    return rom
+
+
+def skip():
+    """3xkk, 4xkk, 5xyn, 9xyn and the Exnn group, including ExnE, Exn1 and ExxF; no key is ever down."""
+    rom = Rom()
+    rom(0x6D00, 0x6E00)
+    rom(0x6B05, 0x6C06)
+    rom(0x3B05, 0x7001,                         # SE taken: V0 stays 0
+        0x3B06, 0x7101,                         # SE not taken: V1 = 1
+        0x4B05, 0x7201,                         # SNE not taken
+        0x4B06, 0x7301,                         # SNE taken
+        0x5BC0, 0x7401,                         # SE Vx, Vy not taken
+        0x5BB0, 0x7501,                         # SE Vx, Vy taken
+        0x5BB1, 0x7601,                         # 5xy1 decodes as 5xy0
+        0x9BC0, 0x7701,                         # SNE Vx, Vy taken
+        0x9BB0, 0x7801,                         # SNE Vx, Vy not taken
+        0x9BC7, 0x7901)                         # 9xy7 decodes as 9xy0
+    rom.dump()
+    rom(0x6000, 0x6100, 0x6200, 0x6300, 0x6400, 0x6500, 0x6600, 0x6700, 0x6800, 0x6900,
+        0xEB9E, 0x7001,                         # SKP: not taken
+        0xEBA1, 0x7101,                         # SKNP: taken
+        0xEB1E, 0x7201,                         # ExnE decodes as SKP
+        0xEB01, 0x7301,                         # Exn1 decodes as SKNP
+        0xEBFF, 0x7401,                         # ExxF: no instruction
+        0xEB00, 0x7501)                         # Ex00: no instruction
+    rom.dump()
+    finish(rom)
+    return rom
+
+
+def system():
+    """The 0nnn group: 0nn0 clears like 00E0, 0nnE returns like 00EE, other 0nnn do nothing."""
+    rom = Rom()
+    rom(0x6D00, 0x6E00)
+    rom(0x6A20, 0x6B08, 0x6000, 0xF029,         # digit 0, which only survives if 0AB0 does not clear
+        0xDAB5, 0x0AB0)
+    rom(0x6000, 0x6100, 0x6200)
+    rom.ref(0x2000, "SUB")                      # CALL SUB, which returns through 012E
+    rom(0x7101,                                 # V1 = 1 once back
+        0x0123, 0x000F, 0x7201)                 # 0123, 000F: no instruction
+    rom.dump()
+    finish(rom)
+    rom.label("SUB")
+    rom(0x7001, 0x012E)                         # ADD V0, 1; 012E
+    return rom
+
+
+def stack():
+    """A 20-deep recursion, beyond the 16 stack levels, dumping at the deepest call and once back out."""
+    rom = Rom()
+    rom(0x6D00, 0x6E00, 0x6000, 0x6100)
+    rom.ref(0x2000, "REC")
+    rom.label("FIN")
+    rom.dump()
+    finish(rom)
+    rom.label("REC")
+    rom(0x7001, 0x4014)                         # ADD V0, 1; SNE V0, 20
+    rom.dump()                                  # at the deepest call
+    rom(0x3014)                                 # SE V0, 20
+    rom.ref(0x2000, "REC")
+    rom(0x7101, 0x3114, 0x00EE)                 # ADD V1, 1; SE V1, 20; RET
+    rom.ref(0x1000, "FIN")                      # the outermost call's slot was reused: jump out instead
+    return rom
+
+
+def flags():
+    """8xy4-8xyE with VF as an operand: VF is assigned first, so the result takes the flag as Vx or Vy."""
+    rom = Rom()
+    rom(0x6D00, 0x6E00)
+    rom(0x6035,
+        0x6F81, 0x8F06, 0x81F0,                 # SHR VF: VF = 1, shifted: V1 = 0
+        0x6F81, 0x8F0E, 0x82F0,                 # SHL VF: VF = 1, shifted: V2 = 2
+        0x6F81, 0x8F05, 0x83F0,                 # SUB VF, V0: VF = 1, 1 - 0x35: V3 = 0xCC
+        0x6F81, 0x8F07, 0x84F0,                 # SUBN VF, V0: VF = 0, 0x35 - 0: V4 = 0x35
+        0x6F81, 0x80F5, 0x8500,                 # SUB V0, VF: VF = 0, 0x35 - 0: V5 = 0x35
+        0x6620, 0x6F81, 0x86F7,                 # SUBN V6, VF: VF = 1, 1 - 0x20: V6 = 0xE1
+        0x6720, 0x6FF0, 0x87F4,                 # ADD V7, VF: the sum is taken first: V7 = 0x10
+        0x6F90, 0x8FF4, 0x88F0,                 # ADD VF, VF: V8 = 0x20
+        0x6F05, 0x8FF5, 0x89F0,                 # SUB VF, VF: V9 = 0
+        0x6F81, 0x8FFE, 0x8AF0)                 # SHL VF with y = F: VA = 2
+    rom.dump()
+    finish(rom)
+    return rom
+
+
+def quirks():
+    """The same program under every profile: shift, VF reset, I increment, Bnnn, clipping, SUPER-CHIP and XO-CHIP."""
+    rom = Rom()
+    rom.ref(0x1000, "START")
+    rom.label("TABLE")                          # Bnnn lands here, or 4 bytes in with jumpVx
+    rom(0x7801, 0x7801, 0x7801)
+    rom.ref(0x1000, "AFTER")
+    rom.label("START")
+    rom(0x6D00, 0x6E00)
+    rom(0x6105, 0x6240, 0x8126,                 # SHR V1, V2: 0x02, or 0x20 shifting Vy
+        0x6305, 0x6440, 0x834E)                 # SHL V3, V4: 0x0A, or 0x80 shifting Vy
+    rom.dump()
+    rom(0x6F07, 0x6055, 0x61F0, 0x8011)         # OR: VF stays 7 unless resetVF
+    rom.dump()
+    rom(0xA000 | (DATA + 2), 0x6033, 0xF055,    # DATA + 2 = 0x33
+        0xA000 | DATA, 0x6011, 0x6122, 0xF155,  # DATA = 0x11, 0x22; I ends at DATA + 2 with incrementIndex
+        0xF065)                                 # V0 = 0x11, or 0x33
+    rom.dump()
+    rom(0x6000, 0x6204, 0x6800)
+    rom.ref(0xB000, "TABLE")                    # JP V0, TABLE: V8 = 3, or V8 = 1 through B2nn + V2
+    rom.label("AFTER")
+    rom.dump()
+    rom(0x6A3E, 0x6B1C, 0x6008, 0xF029,         # digit 8 at (62, 28): clipped, or wrapped to the other corners
+        0xDAB5)
+    rom.dump()
+    rom(0x6000, 0x6100,
+        0x3000, 0xF000, 0x0F03,                 # SE skips F000 NNNN whole on XO-CHIP; otherwise 0F03 runs, doing nothing
+        0x7101,
+        0xF000, 0x0000 | DATA,                  # XO-CHIP: I = DATA
+        0xF065)                                 # V0 = 0x11 on XO-CHIP
+    rom.dump()
+    rom(0x6301, 0x6401, 0x6500,
+        0xA000 | (DATA + 8), 0x5342,            # XO-CHIP: store V3-V4; otherwise skip like 5xy0
+        0x7501,
+        0x6300, 0x6400, 0x5343, 0x7501)         # XO-CHIP: V3-V4 back from DATA + 8; otherwise skip
+    rom.dump()
+    rom(0x6011, 0x6122, 0x6233, 0xF275,         # LD R, V2
+        0x6000, 0x6100, 0x6200, 0xF285)         # LD V2, R: SUPER-CHIP and XO-CHIP get 0x11, 0x22, 0x33 back
+    rom.dump()
+    rom(0x00C2, 0x00FB, 0x00FC)                 # scroll down 2, right 4, left 4
+    rom.dump()
+    rom(0x6014, 0xF015)                         # hold the low-resolution results for 20 frames
+    rom.label("WAIT")
+    rom(0xF007, 0x3000)                         # LD V0, DT; SE V0, 0
+    rom.ref(0x1000, "WAIT")
+    rom(0x00FF, 0x6A40, 0x6B20, 0x6009, 0xF030, # high resolution; big digit 9 at (64, 32)
+        0xDAB0, 0xF201, 0x6A00, 0x6B00,         # 16x16 sprite, then select plane 2
+        0xA000 | SCRATCH, 0xDAB8)               # 8 rows of the register image on plane 2
+    finish(rom)
+    return rom
+
+
+def main():
+    directory = os.path.dirname(os.path.abspath(__file__))
+    roms = {"alu.ch8": alu(), "skip.ch8": skip(), "system.ch8": system(), "stack.ch8": stack(), "flags.ch8": flags()}
+    for profile in ("modern", "vip", "schip", "xochip"):
+        roms["quirks-" + profile + ".ch8"] = quirks()
+    for name, rom in roms.items():
+        with open(os.path.join(directory, name), "wb") as file:
+            file.write(rom.build())
+
+
+if __name__ == "__main__":
+    main()